@@ -20,114 +20,358 @@
 #include "Tree.h"
 #include "Link.h"
 #include "platform.h"
+#include "Profiler.h"
+#include <algorithm>
 
 static const float normalMindStep = 0.5f;
+static const int maxAIThreads = 4;
+static const int maxSearchThreads = 8;		// per mind
+static const int transTableShift = 16;		// 1 MB per mind
+
+static inline unsigned long long mix64(unsigned long long x) {
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	return x ^ (x >> 31);
+}
+
+union FloatBits {
+	float			f;
+	unsigned int	i;
+};
 
-Mind::Move Mind::searchBestMove(int depthStart) {
-	const unsigned int maxSearchingTime = 2000;
-	unsigned int ticks = platform::getTicks();
-	int depth = depthStart;
+// data: score bits, depth << 32, bound << 38, generation << 40, move + 1 << 48
+TransTable::TransTable(int shift): generation(0) {
+	Slot empty = { 0, 0 };
+	slots.assign(1 << shift, empty);
+}
+
+void TransTable::newSearch() {
+	generation = (generation + 1) & 0xFF;
+}
+
+// relaxed, they only keep a 64 bit access whole and cost a plain one on x86, unlike the __sync ones
+static inline unsigned long long loadSlot(const unsigned long long &v) {
+	return __atomic_load_n(&v, __ATOMIC_RELAXED);
+}
+
+static inline void storeSlot(unsigned long long &v, unsigned long long x) {
+	__atomic_store_n(&v, x, __ATOMIC_RELAXED);
+}
+
+bool TransTable::probe(unsigned long long key, Entry &e) const {
+	const Slot &s = slots[key & (slots.size() - 1)];
+	unsigned long long data = loadSlot(s.data);
+	if((loadSlot(s.check) ^ data) != key || ((data >> 40) & 0xFF) != generation)
+		return false;
+	FloatBits score;
+	score.i = (unsigned int)data;
+	e.score = score.f;
+	e.depth = (data >> 32) & 0x3F;
+	e.bound = Bound((data >> 38) & 3);
+	e.move = int(data >> 48) - 1;
+	return true;
+}
+
+// a slot of this search keeps the deeper result, the previous searches are overwritten
+void TransTable::store(unsigned long long key, const Entry &e) {
+	Slot &s = slots[key & (slots.size() - 1)];
+	unsigned long long old = loadSlot(s.data);
+	if(((old >> 40) & 0xFF) == generation && (loadSlot(s.check) ^ old) != key && int((old >> 32) & 0x3F) > e.depth)
+		return;
+	FloatBits score;
+	score.f = e.score;
+	unsigned long long move = e.move >= 0 && e.move < 0xFFFF ? e.move + 1 : 0;
+	unsigned long long data = score.i | (unsigned long long)(e.depth & 0x3F) << 32 | (unsigned long long)e.bound << 38 |
+			(unsigned long long)generation << 40 | move << 48;
+	storeSlot(s.data, data);
+	storeSlot(s.check, key ^ data);
+}
+
+static const unsigned int maxSearchingTime = 2000;
+static const int historyShift = 12;
+static const unsigned long timeCheckMask = 255;		// the clock is read once in so many nodes
+
+// Iterative deepening: every finished depth leaves its best move and its principal variation
+// to order the next one, a depth cut by the time is thrown away.
+Mind::Move Mind::searchBestMove(int maxDepth) {
+	searchStart = platform::getTicks();
+	timeUp = aborted = false;
+	nodes = 0;
+	searchDepth = 0;
+	for(size_t i=0; i<history.size(); ++i)
+		history[i] >>= 1;
+	maxPly = maxDepth + 1;
+	reserveMoves(maxPly);
+	if((int)plyMoves.size() < maxPly) {
+		plyMoves.resize(maxPly);
+		plyOrders.resize(maxPly);
+	}
+	pv.resize(maxPly * maxPly);
+	pvLength.assign(maxPly, 0);
+	killers.assign(maxPly * 2, KeyMove());
+	prevPV.clear();
 
 	std::vector<Mind::Move> moves;
 	calcMoves(playerIdx, moves);
+	std::vector<int> order;
+	for(size_t i=0; i<moves.size(); ++i)
+		order.push_back(i);
 
-	int mc = moves.size();
 	int bestMove = -1;
-	float alpha = -F_INFINITY;
-
-	for(unsigned i=0; i<moves.size(); ++i) {
-		Move m = moves[i];
-		makeMove(playerIdx, m); 
-
-		for(size_t p=0; p < genuses.size(); ++p) {
-			if(genuses[p]->trees.empty())
-				continue;
-			if(p != playerIdx) {
-				float eval = -alphaBeta(p, depth-1, -F_INFINITY, -alpha);
-				if(m.type != MT_NOTING) {
-					MTreeData &dt = treeData(playerIdx, m.from);
-					eval += absf(eval) * (1.0f - dt.doNothingFactor);
-				}
-				if(eval > alpha) {
-					alpha = eval;
-					bestMove = i;
+	unsigned int lastTime = 0;
+	// every other helper is a depth ahead, so the threads fill the table for each other
+	for(rootDepth = 1 + (helperIdx & 1); rootDepth <= maxDepth; ++rootDepth) {
+		unsigned int start = platform::getTicks();
+		int iterationBest = -1;
+		float alpha = -F_INFINITY;
+		pvLength[0] = 0;
+
+		for(size_t k=0; k<order.size() && !timeUp; ++k) {
+			Move m = moves[order[k]];
+			makeMove(playerIdx, m); 
+
+			for(size_t p=0; p < ws.genuses.size() && !timeUp; ++p) {
+				if(!alive[p])
+					continue;
+				if(p != playerIdx) {
+					float eval = -alphaBeta(p, rootDepth-1, -F_INFINITY, -alpha);
+					if(m.type != MT_NOTING) {
+						MTreeData &dt = treeData(playerIdx, m.from);
+						eval += absf(eval) * (1.0f - dt.doNothingFactor);
+					}
+					if(eval > alpha && !timeUp) {
+						alpha = eval;
+						iterationBest = order[k];
+						storePV(0, keyMove(playerIdx, m));
+					}
 				}
 			}
-		}
 
-		undoMove();
+			undoMove();
 
-		if(state == ST_ABORT)
-			return Move(MT_NOTING);
+			if(aborted)
+				return Move(MT_NOTING);
+		}
+		if(timeUp)
+			break;
 
-		if(depth == depthStart) {
-			unsigned int dt = platform::getTicks() - ticks;
-			if(dt>maxSearchingTime)
-				depth = 1;
+		bestMove = iterationBest;
+		searchDepth = rootDepth;
+		if(bestMove >= 0) {
+			std::vector<int>::iterator b = std::find(order.begin(), order.end(), bestMove);
+			std::rotate(order.begin(), b, b + 1);
 		}
+		prevPV.assign(pv.begin(), pv.begin() + pvLength[0]);
+
+		// the next depth takes about as many times longer as this one did over the last
+		unsigned int t = platform::getTicks(), time = std::max(t - start, 1u);
+		if(lastTime && t - searchStart + time * time / lastTime > maxSearchingTime)
+			break;
+		lastTime = time;
 	}
 	return bestMove == -1 ? Move(MT_NOTING) : moves[bestMove];
 }
 
+// the mind searches as task 0, the helpers give up as soon as it is done
+void Mind::searchTask(void *arg, int idx) {
+	Mind *m = (Mind*)arg;
+	if(idx == 0) {
+		m->bestMove = m->searchBestMove(m->depth);
+		for(std::vector<Mind*>::iterator h = m->helpers.begin(); h != m->helpers.end(); ++h)
+			(*h)->abort();
+	} else {
+		Mind *h = m->helpers[idx - 1];
+		if(!__sync_fetch_and_add(&h->abortRequest, 0))
+			h->searchBestMove(m->depth);
+	}
+}
+
+Mind::Move Mind::searchParallel() {
+	for(std::vector<Mind*>::iterator h = helpers.begin(); h != helpers.end(); ++h) {
+		(*h)->copyPosition(*this);
+		(*h)->nodes = 0;
+		(*h)->abortRequest = 0;
+	}
+	searchers->run(searchTask, this, helpers.size() + 1);
+	return bestMove;
+}
+
+inline Mind::KeyMove Mind::keyMove(int race, const Move &m) {
+	return KeyMove(race, m.type, m.from, m.to);
+}
+
+inline unsigned int& Mind::historyOf(const KeyMove &m) {
+	unsigned long long key = mix64((unsigned long long)m.race << 48 ^ (unsigned long long)m.type << 44 ^ (unsigned long long)m.from << 22 ^ m.to);
+	return history[key & ((1 << historyShift) - 1)];
+}
+
+void Mind::storePV(int ply, const KeyMove &m) {
+	KeyMove *line = &pv[ply * maxPly];
+	line[0] = m;
+	int length = ply + 1 < maxPly ? pvLength[ply + 1] : 0;
+	for(int i=0; i<length; ++i)
+		line[i + 1] = pv[(ply + 1) * maxPly + i];
+	pvLength[ply] = length + 1;
+}
+
+// the best move of an earlier visit, the last principal variation, the killers, then by history
+void Mind::orderMoves(int pIdx, int ply, const std::vector<Move> &moves, int ttMove, std::vector<int> &order) {
+	std::vector<unsigned int> &keys = orderKeys;
+	keys.resize(moves.size());
+	order.resize(moves.size());
+	const KeyMove &killer1 = killers[ply * 2], &killer2 = killers[ply * 2 + 1];
+	const KeyMove *pvMove = ply < (int)prevPV.size() ? &prevPV[ply] : 0;
+	for(size_t i=0; i<moves.size(); ++i) {
+		KeyMove m = keyMove(pIdx, moves[i]);
+		if((int)i == ttMove)
+			keys[i] = 0xFFFFFFFF;
+		else if(pvMove && m == *pvMove)
+			keys[i] = 0xFFFFFFFE;
+		else if(m == killer1)
+			keys[i] = 0xFFFFFFFD;
+		else if(m == killer2)
+			keys[i] = 0xFFFFFFFC;
+		else
+			keys[i] = std::min(historyOf(m), 0xFFFFFFFBu);
+		order[i] = i;
+	}
+	// insertion sort, stable so equal moves stay in calcMoves() order
+	for(size_t i=1; i<order.size(); ++i) {
+		int o = order[i];
+		size_t j = i;
+		for(; j > 0 && keys[order[j-1]] < keys[o]; --j)
+			order[j] = order[j-1];
+		order[j] = o;
+	}
+}
+
 float Mind::alphaBeta(int pIdx, int depth, float alpha, float beta) {
-	if(state == ST_ABORT)
+	nodes++;
+	if((nodes & timeCheckMask) == 0) {
+		if(platform::getTicks() - searchStart > maxSearchingTime)
+			timeUp = true;
+		if(__sync_fetch_and_add(&abortRequest, 0))
+			timeUp = aborted = true;
+	}
+	if(timeUp)
 		return -F_INFINITY;
 
+	int ply = rootDepth - depth;
+	pvLength[ply] = 0;
+
 	if(isLooser(pIdx)) 
 		return -F_INFINITY;
 
 	if(depth == 0) 
 		return evaluate(pIdx);
 
-	std::vector<Mind::Move> moves;
+	unsigned long long key = positionKey(pIdx);
+	TransTable::Entry entry;
+	entry.move = -1;
+	// the scores grow with the depth, so only a result of the same depth stands for this one
+	if(useTable && table->probe(key, entry) && entry.depth == depth) {
+		if(entry.bound == TransTable::TB_EXACT)
+			return entry.score;
+		if(entry.bound == TransTable::TB_LOWER && entry.score >= beta)
+			return entry.score;
+		if(entry.bound == TransTable::TB_UPPER && entry.score <= alpha)
+			return entry.score;
+	}
+
+	std::vector<Mind::Move> &moves = plyMoves[ply];
+	moves.clear();
 	calcMoves(pIdx, moves);
+	std::vector<int> &order = plyOrders[ply];
+	orderMoves(pIdx, ply, moves, entry.move, order);
 
+	float alphaStart = alpha;
 	float score = -F_INFINITY;
+	int best = -1;
 
-	for(unsigned i = 0; i < moves.size(); ++i) {
+	bool cutoff = false;
+	for(size_t k = 0; k < order.size() && !cutoff; ++k) {
+		int i = order[k];
 		makeMove(pIdx, moves[i]); 
 
-		for(size_t p = 0; p < genuses.size(); ++p) {
+		for(size_t p = 0; p < ws.genuses.size(); ++p) {
 			if(p != pIdx && !isLooser(p)) {
 				float eval = -alphaBeta(p, depth-1, -beta, -alpha);
 				if(eval > score) {
 					score = eval;
+					best = i;
+					storePV(ply, keyMove(pIdx, moves[i]));
 					if(score > alpha) {
 						alpha = score;		
-						if(alpha >= beta) {
-							undoMove();
-							return alpha;
-						}
+						cutoff = alpha >= beta;
+						if(cutoff)
+							break;
 					}
 				}
 			}
 		}
 		undoMove();
-		if(state == ST_ABORT)
+		if(timeUp)
 			return score;
 	}
 
+	if(cutoff) {
+		KeyMove m = keyMove(pIdx, moves[best]);
+		historyOf(m) += depth * depth;
+		if(best != entry.move && !(m == killers[ply * 2])) {
+			killers[ply * 2 + 1] = killers[ply * 2];
+			killers[ply * 2] = m;
+		}
+	}
+
+	if(useTable) {
+		entry.score = score;
+		entry.depth = depth;
+		entry.bound = score >= beta ? TransTable::TB_LOWER : score <= alphaStart ? TransTable::TB_UPPER : TransTable::TB_EXACT;
+		entry.move = best;
+		table->store(key, entry);
+	}
 	return score;
 }
 
 inline Mind::MTree& Mind::tree(int race, int planet) {
-	return trees[ stack * stackSize + planet*genuses.size() + race ];
+	return trees[ planet*ws.genuses.size() + race ];
 } 
 
+// the key drops the tree as it was when it is logged, makeMove() adds it back as it ends up
+inline Mind::MTree& Mind::changeTree(int idx) {
+	MTree &t = trees[idx];
+	if(treeMoves[idx] != moveCount) {
+		treeMoves[idx] = moveCount;
+		TreeChange c = { idx, t };
+		treeLog.push_back(c);
+		treesKey ^= treeKey(idx, t);
+	}
+	return t;
+}
+
+inline Mind::MTree& Mind::changeTree(int race, int planet) {
+	return changeTree(planet*ws.genuses.size() + race);
+}
+
 inline Mind::MTreeData& Mind::treeData(int race, int planet) {
-	return treesData[ planet*genuses.size() + race ];
+	return treesData[ planet*ws.genuses.size() + race ];
+} 
+
+inline Mind::MGrowth& Mind::growthOf(int race, int planet) {
+	return growth[ planet*ws.genuses.size() + race ];
 } 
 
 void Mind::initPosition() {
-	stack = 0; 
-	trees.clear();
-	trees.resize(stackSize);
+	trees.assign(boardSize, MTree());
 	links.clear();
-	linksIdx.clear();
-	linksIdx.push_back(0);
-
-	for(unsigned ip=0; ip<planets.size(); ++ip) {
-		Planet *p = planets[ip];
+	treeLog.clear();
+	linkLog.clear();
+	frames.clear();
+	treeMoves.assign(boardSize, 0);
+	moveCount = 0;
+
+	for(unsigned ip=0; ip<ws.planets.size(); ++ip) {
+		Planet *p = ws.planets[ip];
 		for(std::vector<Tree*>::iterator it = p->trees.begin(); it != p->trees.end(); ++it) { 
 			MTree& t = tree((*it)->genus->index, ip);
 			MTreeData& dt = treeData((*it)->genus->index, ip);
@@ -157,40 +401,105 @@ void Mind::initPosition() {
 		}
 	}
 
+	blackList = ws.blackList;
+	for(size_t r=0; r<ws.genuses.size(); ++r)
+		alive[r] = !ws.genuses[r]->trees.empty();
+
+	linksKey = 0;
+	for(std::vector<MLink>::iterator l = links.begin(); l != links.end(); ++l)
+		linksKey ^= linkKey(*l);
+	hashTrees();
+}
+
+// a helper starts from the position its mind took from the world
+void Mind::copyPosition(const Mind &m) {
+	trees = m.trees;
+	treesData = m.treesData;
+	links = m.links;
+	treeLog.clear();
+	linkLog.clear();
+	frames.clear();
+	treeMoves.assign(boardSize, 0);
+	moveCount = 0;
+	linksKey = m.linksKey;
+	treesKey = m.treesKey;
+	blackList = m.blackList;
+	alive = m.alive;
+	useTable = m.useTable;
 }
 
-void Mind::dublicateStack() {
-	stack++;
-	trees.resize(stackSize*(stack+1));
-	memcpy(&trees[stackSize*stack], &trees[stackSize*(stack-1)], stackSize*sizeof(MTree));
+// Room for count more moves, so that neither the logs nor the links grow inside the search.
+// A move logs every tree at most once, adds at most one link and removes at most all of them.
+void Mind::reserveMoves(int count) {
+	int moves = frames.size() + count;
+	int maxLinks = links.size() + count;
+	frames.reserve(moves);
+	links.reserve(maxLinks);
+	treeLog.reserve(moves * boardSize);
+	linkLog.reserve(moves * (maxLinks + 1));
+}
 
-	int idx = linksIdx.back();
-	int newIdx = links.size(); 
-	int s = newIdx - idx;
-	if(s > 0) {
-		links.resize(newIdx + s);
-		memcpy(&links[newIdx], &links[idx], s * sizeof(MLink) );
-	}
-	linksIdx.push_back(newIdx);
+// the links are hashed one by one and so in any order, so are the trees
+unsigned long long Mind::linkKey(const MLink &l) {
+	FloatBits length;
+	length.f = l.length;
+	return mix64((unsigned long long)l.race << 40 | (unsigned long long)l.from << 20 | l.to) ^ mix64((unsigned long long)length.i << 1 | l.canUnlink);
+}
+
+inline unsigned long long Mind::treeKey(int idx, const MTree &t) {
+	if(t.length < 0 && t.treeLength < 0 && t.links == 0)
+		return 0;
+	FloatBits length, treeLength;
+	length.f = t.length;
+	treeLength.f = t.treeLength;
+	return mix64((unsigned long long)length.i << 32 | treeLength.i) ^ mix64((unsigned long long)idx << 16 | (t.links & 0xFFFF));
+}
+
+void Mind::hashTrees() {
+	treesKey = 0;
+	for(int i=0; i<boardSize; ++i)
+		treesKey ^= treeKey(i, trees[i]);
+}
+
+// swaps the last link in, as the search did before
+void Mind::removeLink(int idx) {
+	LinkChange c = { idx, links[idx] };
+	linkLog.push_back(c);
+	linksKey ^= linkKey(links[idx]);
+	links[idx] = links.back();
+	links.pop_back();
 }
 
 void Mind::undoMove() {
-	stack--;
-	trees.resize(stackSize*(stack+1));
-	links.resize(linksIdx.back());
-	linksIdx.pop_back();
+	const Frame &f = frames.back();
+	for(; (int)treeLog.size() > f.treeLog; treeLog.pop_back())
+		trees[treeLog.back().idx] = treeLog.back().old;
+	for(; (int)linkLog.size() > f.linkLog; linkLog.pop_back()) {
+		const LinkChange &c = linkLog.back();
+		if(c.idx < 0)
+			links.pop_back();
+		else if(c.idx == (int)links.size())
+			links.push_back(c.old);
+		else {
+			links.push_back(links[c.idx]);
+			links[c.idx] = c.old;
+		}
+	}
+	linksKey = f.linksKey;
+	treesKey = f.treesKey;
+	frames.pop_back();
 }
 
 void Mind::proceedMove(float step) {
-	for(unsigned r=0; r<genuses.size(); ++r) {
-		for(unsigned p=0; p<planets.size(); ++p) {
-			MTreeData &d = treeData(r, p);
+	for(unsigned r=0; r<ws.genuses.size(); ++r) {
+		for(unsigned p=0; p<ws.planets.size(); ++p) {
+			MGrowth &d = growthOf(r, p);
 			d.growing = d.accumulator = 0;
 			MTree &t = tree(r, p);
 			if(t.treeLength >= 0) {
-				d.growing = step * ( 1.0f + log(t.treeLength*0.8f + 1.0f) ) * genuses[r]->growingFactor * planets[p]->rich; //( 1.0f + log((float)coma.getLength() + 1.0f) ) * race->growingFactor;
+				d.growing = step * ( 1.0f + log(t.treeLength*0.8f + 1.0f) ) * ws.genuses[r]->growingFactor * ws.planets[p]->rich; //( 1.0f + log((float)coma.getLength() + 1.0f) ) * race->growingFactor;
 				if(t.links > 0) {
-					float maxLength = planets[p]->maxLength;
+					float maxLength = ws.planets[p]->maxLength;
 //					if(t.length + d.growing / t.links > maxLength) {	// monopoly case
 //						d.accumulator = maxLength - t.length;
 //						d.growing -= d.accumulator;
@@ -207,60 +516,47 @@ void Mind::proceedMove(float step) {
 		}
 	}
 
-	for(size_t i = linksIdx.back(); i<links.size(); ++i) {
+	for(size_t i = 0; i<links.size(); ++i) {
 		MLink &l = links[i];
-		MTreeData &d1 = treeData(l.race, l.from);
-		MTreeData &d2 = treeData(l.race, l.to);
+		MGrowth &d1 = growthOf(l.race, l.from);
+		MGrowth &d2 = growthOf(l.race, l.to);
 		d2.accumulator += d1.growing;
 	}
 
-	for(unsigned p=0; p<planets.size(); ++p) {
-		for(;;) {
-			float sum = 0;
-			int cnt = 0;
-			for(unsigned r=0; r<genuses.size(); ++r) {
-				MTree &t = tree(r, p);
-				MTreeData &d = treeData(r, p);
-				if(t.length>=0) {
-					t.length += d.accumulator;
-					d.accumulator = 0;
-					sum += t.length;
-					cnt++;
-				}
-			}
-			if(cnt == 0)
-				break;
-			float overLength = sum - planets[p]->maxLength;
-			if(overLength <= EPSILON)
-				break;
-			float sumWeakness = 0;
-			for(unsigned r=0; r<genuses.size(); ++r) {
-				MTree &t = tree(r, p);
-				if(t.length>=0) 
-					sumWeakness += genuses[r]->weakness;
-			}
-			for(unsigned r=0; r<genuses.size(); ++r) {
-				MTree &t = tree(r, p);
-				if(t.length>=0) 
-					t.length -= overLength * genuses[r]->weakness / sumWeakness;
+	for(unsigned p=0; p<ws.planets.size(); ++p) {
+		int cnt = 0;
+		for(unsigned r=0; r<ws.genuses.size(); ++r) {
+			MTree &t = tree(r, p);
+			MGrowth &d = growthOf(r, p);
+			if(t.length>=0) {
+				if(d.accumulator != 0)
+					changeTree(r, p).length += d.accumulator;
+				d.accumulator = 0;
+				fitLengths[cnt] = t.length;
+				fitWeakness[cnt] = ws.genuses[r]->weakness;
+				fitRaces[cnt++] = r;
 			}
 		}
+		if(cnt && Planet::fitLengths(&fitLengths[0], &fitWeakness[0], &fitOrder[0], cnt, ws.planets[p]->maxLength))
+			for(int i=0; i<cnt; ++i) {
+				float length = fitLengths[i] > 0 ? fitLengths[i] : -1.0f;	// squeezed out trees die
+				if(tree(fitRaces[i], p).length != length)
+					changeTree(fitRaces[i], p).length = length;
+			}
 	}
 
-	for(size_t i = stack * stackSize; i<trees.size(); ++i) {
-		MTree &t = trees[i];
-		t.treeLength = t.length;
-	}
+	for(int i=0; i<boardSize; ++i)
+		if(trees[i].treeLength != trees[i].length)
+			changeTree(i).treeLength = trees[i].length;
 
-	for(size_t i = linksIdx.back(); i<links.size(); ) { // drop links from dead trees
+	for(size_t i = 0; i<links.size(); ) { // drop links from dead trees
 		MLink &l = links[i];
 		MTree &t = tree(l.race, l.from);
-		if(t.length<0) {
-			l = links.back();
-			links.pop_back();
-		} else {
+		if(t.length<0)
+			removeLink(i);
+		else {
 			if(t.treeLength>0)
-				t.treeLength = std::max(0.0f, t.treeLength - l.length);
+				changeTree(l.race, l.from).treeLength = std::max(0.0f, t.treeLength - l.length);
 			++i;
 		}
 	}
@@ -270,8 +566,8 @@ void Mind::proceedMove(float step) {
 float Mind::evaluate(int pidx) {
 	float result = 0;
 
-	for(unsigned r=0; r<genuses.size(); ++r) {
-		for(unsigned p=0; p<planets.size(); ++p) {
+	for(unsigned r=0; r<ws.genuses.size(); ++r) {
+		for(unsigned p=0; p<ws.planets.size(); ++p) {
 			MTree &t = tree(r, p);
 			if(t.length >= 0)
 				result += r==pidx? t.length : -t.length;
@@ -281,7 +577,7 @@ float Mind::evaluate(int pidx) {
 }
 
 bool Mind::isLooser(int pidx) {
-	for(unsigned p=0; p<planets.size(); ++p) {
+	for(unsigned p=0; p<ws.planets.size(); ++p) {
 		MTree &t = tree(pidx, p);
 		if(t.length > 0)
 			return false;
@@ -290,7 +586,7 @@ bool Mind::isLooser(int pidx) {
 }
 
 bool Mind::haveLink(int race, int from, int to) {
-	for(size_t i = linksIdx.back(); i<links.size(); ++i) {
+	for(size_t i = 0; i<links.size(); ++i) {
 		MLink &l = links[i];
 		if(l.race == race) {
 			if(l.from == from && l.to == to)
@@ -305,23 +601,23 @@ bool Mind::haveLink(int race, int from, int to) {
 void Mind::calcMoves(int pIdx, std::vector<Mind::Move> &moves) {
 	moves.push_back(Move(MT_NOTING));
 
-	for(size_t i = linksIdx.back(); i<links.size(); ++i) {
+	for(size_t i = 0; i<links.size(); ++i) {
 		MLink &l = links[i];
 		if(l.race == pIdx && l.canUnlink)
-			moves.push_back(Move(MT_UNLINK, i-linksIdx.back(), l.from, l.to));
+			moves.push_back(Move(MT_UNLINK, i, l.from, l.to));
 	}
 
-	for(unsigned p=0; p<planets.size(); ++p) {
+	for(unsigned p=0; p<ws.planets.size(); ++p) {
 		MTree &t = tree(pIdx, p);
 		if(t.length>0) {
 			MTreeData &dt = treeData(pIdx, p);
 			if(dt.canLink) {
-				Planet *planet = planets[p];
-				for(size_t i=0; i<planet->links.size(); ++i) {
-					Planet::PlanetLink &l = planet->links[i];
+				Planet *planet = ws.planets[p];
+				for(int i=planet->linksBegin; i<planet->linksEnd; ++i) {
+					Planet::PlanetLink &l = ws.links[i];
 					if(l.distance < t.treeLength)
 						if(!haveLink(pIdx, p, l.planet->index))	{		// TODO: slowly function
-							float d = planet->blackListDistance(genuses[pIdx], l.planet);
+							float d = blackList[pIdx * ws.links.size() + i];
 							if(d < t.treeLength)
 								moves.push_back(Move(MT_LINK, p, l.planet->index, l.distance));
 						}
@@ -332,46 +628,100 @@ void Mind::calcMoves(int pIdx, std::vector<Mind::Move> &moves) {
 }
 
 void Mind::makeMove(int pIdx, const Move &m) {
-	dublicateStack();
+	Frame f = { (int)treeLog.size(), (int)linkLog.size(), linksKey, treesKey };
+	frames.push_back(f);
+	moveCount++;
 	switch(m.type) {
 		case MT_NOTING:
 			break;
 		case MT_UNLINK:
 			{
-				MLink &l = links[linksIdx.back() + m.idx];
-				MTree &t = tree(l.race, l.from);
+				MLink &l = links[m.idx];
+				MTree &t = changeTree(l.race, l.from);
 				t.treeLength += l.length;
 				t.links--;
-				l = links.back();
-				links.pop_back();
+				removeLink(m.idx);
 			}
 			break;
 		case MT_LINK: 
 			{
 				links.push_back(MLink(pIdx, m.from, m.to, m.length, true));
-				MTree &t = tree(pIdx, m.from);
+				LinkChange c = { -1, links.back() };
+				linkLog.push_back(c);
+				linksKey ^= linkKey(links.back());
+				MTree &t = changeTree(pIdx, m.from);
 				t.treeLength -= m.length;
 				t.links++;
-				MTree &t2 = tree(pIdx, m.to);
-				if(t2.length<0)
+				if(tree(pIdx, m.to).length<0) {
+					MTree &t2 = changeTree(pIdx, m.to);
 					t2.length = t2.treeLength = 0;
+				}
 			}
 			break;
 	}
 	proceedMove(normalMindStep);	
+	for(size_t i = f.treeLog; i<treeLog.size(); ++i)
+		treesKey ^= treeKey(treeLog[i].idx, trees[treeLog[i].idx]);
+}
+
+Mind::Mind(World *w, int pidx, int d, int searchThreads): world(w), ws(w->getState()), playerIdx(pidx), depth(d), table(new TransTable(transTableShift)), useTable(true), nodes(0),
+		master(0), helperIdx(0), searchers(0), state(ST_STOP), running(false), abortRequest(0), searchDepth(0) {
+	init();
+	setSearchThreads(searchThreads);
+}
+
+Mind::Mind(Mind *m, int idx): world(m->world), ws(m->ws), playerIdx(m->playerIdx), depth(m->depth), table(m->table), useTable(m->useTable), nodes(0),
+		master(m), helperIdx(idx), searchers(0), state(ST_STOP), running(false), abortRequest(0), searchDepth(0) {
+	init();
 }
 
-Mind::Mind(int pidx, int d): playerIdx(pidx), depth(d), state(ST_STOP) {
+void Mind::init() {
 	ticks = platform::getTicks();
-	stackSize = genuses.size()*planets.size();
-	treesData.resize(stackSize);
+	boardSize = ws.genuses.size()*ws.planets.size();
+	treesData.resize(boardSize);
+	growth.resize(boardSize);
+	fitLengths.resize(ws.genuses.size());
+	fitWeakness.resize(ws.genuses.size());
+	fitRaces.resize(ws.genuses.size());
+	fitOrder.resize(ws.genuses.size());
+	alive.resize(ws.genuses.size());
+	history.assign(1 << historyShift, 0);
+}
+
+Mind::~Mind() {
+	setSearchThreads(1);
+	if(!master)
+		delete table;
 }
 
-Mind::~Mind() {}
+void Mind::setSearchThreads(int count) {
+	count = std::max(1, std::min(count, maxSearchThreads));
+	if(master || count == getSearchThreads())
+		return;
+	for(std::vector<Mind*>::iterator h = helpers.begin(); h != helpers.end(); ++h)
+		delete *h;
+	helpers.clear();
+	delete searchers;
+	searchers = 0;
+	if(count > 1) {
+		for(int i=1; i<count; ++i)
+			helpers.push_back(new Mind(this, i));
+		searchers = new ThreadPool(count);
+	}
+}
+
+unsigned long Mind::getNodes() {
+	unsigned long n = nodes;
+	for(std::vector<Mind*>::iterator h = helpers.begin(); h != helpers.end(); ++h)
+		n += (*h)->nodes;
+	return n;
+}
 
 bool Mind::threadUpdate() {
 	if(state == ST_SEARCHING) {
-		bestMove = searchBestMove(depth);
+		ProfileTimer pt(PP_AI_SEARCH);
+		table->newSearch();		// before any helper starts
+		bestMove = helpers.empty() ? searchBestMove(depth) : searchParallel();
 		state = ST_READY;
 		return true;
 	}
@@ -413,24 +763,14 @@ bool Mind::update() {
 					{
 						MTreeData &dt = treeData(playerIdx, bestMove.from); 
 						dt.doNothingFactor = nothingFactorMax;
-						Genus *r = genuses[playerIdx];
-						Planet *from = planets[bestMove.from];
-						Tree *t = from->getTree(r);
-						if(!t)
-							return false;
-						return t->unlink(planets[bestMove.to]);
+						return world->unlink(ws.genuses[playerIdx], ws.planets[bestMove.from], ws.planets[bestMove.to]);
 					}
 					break;
 				case MT_LINK:
 					{
 						MTreeData &dt = treeData(playerIdx, bestMove.from); 
 						dt.doNothingFactor = nothingFactorMax;
-						Genus *r = genuses[playerIdx];
-						Planet *from = planets[bestMove.from];
-						Tree *t = from->getTree(r);
-						if(!t)
-							return false;
-						return t->link(planets[bestMove.to]);
+						return world->link(ws.genuses[playerIdx], ws.planets[bestMove.from], ws.planets[bestMove.to]);
 					}
 					break;
 			}
@@ -442,27 +782,54 @@ bool Mind::update() {
 }
 
 void Mind::abort() {
-	state = ST_ABORT;
+	__sync_lock_test_and_set(&abortRequest, 1);
 }
 
-AI::AI(): finish(false) {
+// only the do nothing factors outlive a search, the position is taken again from the world.
+// The search only reads them and update() writes them on this thread, so a running search may stay.
+void Mind::save(SnapshotWriter &s) {
+	s.put((unsigned int)treesData.size());
+	for(std::vector<MTreeData>::iterator d = treesData.begin(); d != treesData.end(); ++d)
+		s.put(d->doNothingFactor);
+}
+
+void Mind::load(SnapshotReader &s) {
+	unsigned int count = s.get<unsigned int>();
+	for(unsigned int i=0; i<count && !s.failed(); ++i) {
+		float f = s.get<float>();
+		if(i < treesData.size())
+			treesData[i].doNothingFactor = f;
+	}
+	state = ST_STOP;
+}
+
+AI::AI(int threadCount): finish(false), suspended(false) {
 	pthread_mutex_init(&mutex, 0);
-	pthread_cond_init(&cond, 0);
-	pthread_create(&thread, 0, threadFunc, this);
+	pthread_cond_init(&jobCond, 0);
+	pthread_cond_init(&doneCond, 0);
+	if(threadCount <= 0)
+		threadCount = std::min(platform::getCPUCount(), maxAIThreads);
+	threads.resize(std::max(threadCount, 1));
+	for(size_t i=0; i<threads.size(); ++i)
+		pthread_create(&threads[i], 0, threadFunc, this);
 }
 
 AI::~AI() {
+	abort();
 	pthread_mutex_lock(&mutex);
 	finish = true;
-	pthread_cond_signal(&cond);
+	pthread_cond_broadcast(&jobCond);
 	pthread_mutex_unlock(&mutex);
 
-	pthread_join(thread, 0);
+	for(size_t i=0; i<threads.size(); ++i)
+		pthread_join(threads[i], 0);
 	pthread_mutex_destroy(&mutex);
-	pthread_cond_destroy(&cond);
+	pthread_cond_destroy(&jobCond);
+	pthread_cond_destroy(&doneCond);
 }
 
 void AI::clear() {
+	abort();
 	pthread_mutex_lock(&mutex);
 	for(std::vector<Mind*>::iterator m = minds.begin(); m != minds.end(); ++m)
 		delete *m;
@@ -476,57 +843,101 @@ void AI::add(Mind *m) {
 	pthread_mutex_unlock(&mutex);
 }
 
+// drops the queued searches and waits for the running ones to give up
 void AI::abort() {
 	for(std::vector<Mind*>::iterator m = minds.begin(); m != minds.end(); ++m)
 		(*m)->abort();
 	pthread_mutex_lock(&mutex);
+	for(std::vector<Mind*>::iterator m = jobs.begin(); m != jobs.end(); ++m)
+		(*m)->running = false;
+	jobs.clear();
+	for(;;) {
+		bool running = false;
+		for(std::vector<Mind*>::iterator m = minds.begin(); m != minds.end(); ++m)
+			running |= (*m)->running;
+		if(!running)
+			break;
+		pthread_cond_wait(&doneCond, &mutex);
+	}
+	for(std::vector<Mind*>::iterator m = minds.begin(); m != minds.end(); ++m) {
+		(*m)->state = Mind::ST_ABORT;
+		(*m)->abortRequest = 0;
+	}
 	pthread_mutex_unlock(&mutex);
 }
 
 void AI::update() {
-	if(pthread_mutex_trylock(&mutex))
-		return;							// mutex already locked
-
-	for(std::vector<Mind*>::iterator m = minds.begin(); m != minds.end(); ++m)
-		(*m)->update();
-
-	pthread_cond_signal(&cond);	
+	pthread_mutex_lock(&mutex);
+	if(!suspended)
+		for(std::vector<Mind*>::iterator m = minds.begin(); m != minds.end(); ++m) {
+			if((*m)->running)
+				continue;
+			(*m)->update();
+			if((*m)->state == Mind::ST_SEARCHING) {
+				(*m)->running = true;
+				jobs.push_back(*m);
+				pthread_cond_signal(&jobCond);
+			}
+		}
 	pthread_mutex_unlock(&mutex);
 }
 
-bool AI::threadUpdate() {
-	int rc = pthread_mutex_lock(&mutex);
+bool AI::work() {
+	pthread_mutex_lock(&mutex);
+	while(!finish && jobs.empty())
+		pthread_cond_wait(&jobCond, &mutex);
 	if(finish) {
-		rc = pthread_mutex_unlock(&mutex);
-		return true;
-	}
-	rc = pthread_cond_wait(&cond, &mutex);
-	if(rc) {
-//		LOGE("Thread condwait failed, rc=%d", rc);
 		pthread_mutex_unlock(&mutex);
-		exit(1);
+		return false;
 	}
-	for(std::vector<Mind*>::iterator m = minds.begin(); m != minds.end(); ++m)
-		(*m)->threadUpdate();
-	rc = pthread_mutex_unlock(&mutex);
-	return false;
+	Mind *m = jobs.front();
+	jobs.erase(jobs.begin());
+	pthread_mutex_unlock(&mutex);
+
+	m->threadUpdate();
+
+	pthread_mutex_lock(&mutex);
+	m->running = false;
+	pthread_cond_broadcast(&doneCond);
+	pthread_mutex_unlock(&mutex);
+	return true;
 }
 
 void* AI::threadFunc(void* arg) {
-	for(;;) {
-		AI *ai = (AI*) arg;
-		if(ai->threadUpdate())
-			break;
-	}
+	AI *ai = (AI*) arg;
+	while(ai->work())
+		;
 	return 0;
 }
 
 void AI::suspend() {
-	for(std::vector<Mind*>::iterator m = minds.begin(); m != minds.end(); ++m)
-		(*m)->abort();
+	abort();
 	pthread_mutex_lock(&mutex);
+	suspended = true;
+	pthread_mutex_unlock(&mutex);
 }
 
+// the aborted searches start over from the current position
 void AI::resume() {
+	pthread_mutex_lock(&mutex);
+	suspended = false;
+	for(std::vector<Mind*>::iterator m = minds.begin(); m != minds.end(); ++m)
+		if((*m)->state == Mind::ST_ABORT)
+			(*m)->state = Mind::ST_STOP;
 	pthread_mutex_unlock(&mutex);
 }
+
+// the workers only read the saved data, it is written from update() on this thread
+void AI::save(SnapshotWriter &s) {
+	s.put((unsigned int)minds.size());
+	for(std::vector<Mind*>::iterator m = minds.begin(); m != minds.end(); ++m)
+		(*m)->save(s);
+}
+
+bool AI::load(SnapshotReader &s) {
+	if(s.get<unsigned int>() != minds.size())
+		return false;
+	for(std::vector<Mind*>::iterator m = minds.begin(); m != minds.end(); ++m)
+		(*m)->load(s);
+	return !s.failed();
+}
@@ -16,21 +16,70 @@
 #ifndef AI_H
 #define AI_H
 
+#include "Snapshot.h"
+#include "ThreadPool.h"
 #include <vector>
 #include <pthread.h>
 
 class Planet;
+class World;
+class WorldState;
+
+// Search results by position. A slot keeps key ^ data beside data, so a torn or racing write
+// reads as a miss and the table needs no lock, the helpers of a mind search with the same one.
+class TransTable {
+public:
+	enum Bound {
+		TB_EXACT,
+		TB_LOWER,					// the score is at least this
+		TB_UPPER					// the score is at most this
+	};
+	struct Entry {
+		float	score;
+		int		depth, move;		// move is the index in calcMoves() order or -1
+		Bound	bound;
+	};
+private:
+	struct Slot {
+		unsigned long long	check, data;		// read and written atomically one by one
+	};
+	std::vector<Slot>	slots;
+	unsigned int	generation;
+public:
+			TransTable(int shift);
+	void	newSearch();			// the results of the previous searches turn into misses
+	bool	probe(unsigned long long key, Entry &e) const;
+	void	store(unsigned long long key, const Entry &e);
+	size_t	getMemory() const		{	return slots.size() * sizeof(Slot);	}
+};
 
 class Mind {
-	int		playerIdx, depth, stack, stackSize;
+friend class AI;
+	World	*world;
+	WorldState	&ws;
+	int		playerIdx, depth, boardSize;		// boardSize trees, one per race and planet
 	unsigned int ticks;
+	TransTable	*table;				// owned by the mind, shared with its helpers
+	bool	useTable;
+	unsigned long	nodes;
+
+	// Lazy SMP: the helpers search the same position on the other threads of the pool and only
+	// share the table, so the mind finds more of its positions there and alone picks the move
+	Mind	*master;				// of a helper, 0 for the mind itself
+	int		helperIdx;
+	std::vector<Mind*>	helpers;
+	ThreadPool	*searchers;			// 0 with no helpers
 	float	alphaBeta(int pIdx, int depth, float alpha, float beta);
 
+	// only read by the search, so a snapshot can be taken while it runs
 	struct MTreeData {
 		bool  canLink;
 		float doNothingFactor;
+		MTreeData(): canLink(true), doNothingFactor(1.0f) {}
+	};
+
+	struct MGrowth {				// proceedMove() scratch
 		float growing, accumulator;
-		MTreeData(): canLink(true), doNothingFactor(1.0f), growing(0), accumulator(0) {}
 	};
 
 	struct MTree {
@@ -48,12 +97,40 @@ class Mind {
 		MLink(int r, int f, int t, float l, bool cul): race(r), from(f), to(t), length(l), canUnlink(cul)	{}
 	};
 
+	// A move changes the position in place and logs what it overwrote, undoMove() puts it back.
+	// The logs are reserved for the deepest search, so the search itself never allocates them.
+	struct TreeChange {
+		int		idx;
+		MTree	old;
+	};
+	struct LinkChange {
+		int		idx;				// where old was removed, -1 for an added link
+		MLink	old;
+	};
+	struct Frame {
+		int		treeLog, linkLog;			// log sizes before the move
+		unsigned long long	linksKey, treesKey;
+	};
+
 	std::vector<MTree>	trees;
 	std::vector<MTreeData>	treesData;
+	std::vector<MGrowth>	growth;
 	std::vector<MLink>	links;
-	std::vector<int>	linksIdx;
+	std::vector<TreeChange>	treeLog;
+	std::vector<LinkChange>	linkLog;
+	std::vector<Frame>	frames;
+	std::vector<unsigned int>	treeMoves;		// per tree the last move that logged it
+	unsigned int	moveCount;
+	unsigned long long	linksKey, treesKey;
+	std::vector<float>	blackList;					// the world's one when the search started
+	std::vector<bool>	alive;						// per race
+	std::vector<float>	fitLengths, fitWeakness;	// proceedMove() scratch, one per race
+	std::vector<int>	fitRaces, fitOrder;
 	MTree&	tree(int race, int planet);
+	MTree&	changeTree(int idx);		// logs the tree once per move
+	MTree&	changeTree(int race, int planet);
 	MTreeData&	treeData(int race, int planet);
+	MGrowth&	growthOf(int race, int planet);
 	enum MoveType {
 		MT_NOTING,
 		MT_LINK,
@@ -80,14 +157,44 @@ class Mind {
 		ST_ABORT
 	};
 
+	// a move known by race and planets, so it matches in other positions too
+	struct KeyMove {
+		int			race;
+		MoveType	type;
+		int			from, to;
+		KeyMove(): race(-1), type(MT_NOTING), from(-1), to(-1)									{}
+		KeyMove(int r, MoveType t, int f, int tt): race(r), type(t), from(f), to(tt)			{}
+		bool operator==(const KeyMove &m) const	{	return race == m.race && type == m.type && from == m.from && to == m.to;	}
+	};
+
 	Move			bestMove;
 	State			state;
-
+	bool			running;		// queued or searched by a worker, under the AI mutex
+
+	unsigned int	searchStart;
+	bool			timeUp, aborted;		// timeUp is set by both
+	volatile int	abortRequest;			// set by abort() from another thread
+	int				rootDepth, maxPly, searchDepth;
+	std::vector<KeyMove>	pv, prevPV;		// a line per ply, the line of the last finished depth
+	std::vector<int>		pvLength;
+	std::vector<KeyMove>	killers;		// two per ply
+	std::vector<unsigned int>	history, orderKeys;
+	std::vector<std::vector<Move> >	plyMoves;		// kept between the nodes, so they only grow
+	std::vector<std::vector<int> >	plyOrders;
+
+			Mind(Mind *m, int idx);		// a helper
+	void	init();
 	void	clear();
 	void	initPosition();
+	void	copyPosition(const Mind &m);
+	void	reserveMoves(int count);
+	unsigned long long	linkKey(const MLink &l);
+	unsigned long long	treeKey(int idx, const MTree &t);
+	void	hashTrees();
+	unsigned long long	positionKey(int pIdx)		{	return linksKey ^ treesKey ^ (pIdx + 1) * 0x9E3779B97F4A7C15ULL;	}
 	void	addLink(int pidx, int from, int to);
 	void	calcMoves(int pIdx, std::vector<Move> &moves);
-	void	dublicateStack();
+	void	removeLink(int idx);
 	void	proceedMove(float step);
 	void	makeMove(int pIdx, const Move &m);
 	void	undoMove();
@@ -95,33 +202,52 @@ class Mind {
 	bool	isLooser(int pidx);
 
 	bool	haveLink(int pIdx, int from, int to);
-	Move	searchBestMove(int depth);
+	Move	searchBestMove(int maxDepth);
+	Move	searchParallel();
+	static	void	searchTask(void *arg, int idx);
+	KeyMove	keyMove(int race, const Move &m);
+	unsigned int&	historyOf(const KeyMove &m);
+	void	storePV(int ply, const KeyMove &m);
+	void	orderMoves(int pIdx, int ply, const std::vector<Move> &moves, int ttMove, std::vector<int> &order);
 public:
-			Mind(int pidx, int d);
+			Mind(World *w, int pidx, int d, int searchThreads = 1);
 			~Mind();
 	bool	update();
 	bool	threadUpdate();
 	void	abort();
+	void	setTransTable(bool on)	{	useTable = on;	}		// on by default
+	void	setSearchThreads(int count);						// not while searching
+	int		getSearchThreads()		{	return helpers.size() + 1;	}
+	unsigned long	getNodes();								// of the last search, with the helpers
+	int		getSearchDepth()		{	return searchDepth;	}	// the last depth the last search finished
+	void	save(SnapshotWriter &s);
+	void	load(SnapshotReader &s);
 };
 
+// Every mind's search is a job for a few worker threads, so the minds think in parallel.
+// The minds are updated and their moves made on the world's thread between the searches.
 class AI {
-	std::vector<Mind*> minds;
-	bool	threadUpdate();
+	std::vector<Mind*>		minds;
+	std::vector<Mind*>		jobs;
+	std::vector<pthread_t>	threads;
+	bool	work();
 	static	void*	threadFunc(void* arg);
 
-	pthread_t		thread;
 	pthread_mutex_t	mutex;
-	pthread_cond_t	cond;
-	bool			finish;
+	pthread_cond_t	jobCond, doneCond;
+	bool			finish, suspended;
 public:
-			AI();
+			AI(int threadCount = 0);		// 0 - one per core
 			~AI();
 	void	clear();
 	void	add(Mind *m);
+	int		getThreadCount()		{	return threads.size();	}
 	void	update();
 	void	abort();
 	void	suspend();
 	void	resume();
+	void	save(SnapshotWriter &s);
+	bool	load(SnapshotReader &s);
 };
 
 #endif
@@ -33,13 +33,14 @@ LOCAL_MODULE    := libGame
 LOCAL_C_INCLUDES := $(LOCAL_PATH)/libpng $(LOCAL_PATH)/libzip $(LOCAL_PATH)/libfreetype/include $(LOCAL_PATH)/libopenal/include $(LOCAL_PATH)/libopenal/OpenAL32/Include $(LOCAL_PATH)/libogg/include $(LOCAL_PATH)/libvorbis/include
 
 LOCAL_LDLIBS    := -lz -lGLESv2 -llog -lOpenSLES
+#LOCAL_CFLAGS   += -DPROFILE_BUILD		# the menu key toggles the phase profiler
 
 LOCAL_SRC_FILES := native.cpp \
 					FBO.cpp VBO.cpp Render.cpp Shader.cpp Texture.cpp \
 					JSONParser.cpp ResourceManager.cpp Font.cpp Chapter.cpp MainMenu.cpp \
 					Link.cpp AI.cpp Planet.cpp HalfTree.cpp Genus.cpp Tree.cpp World.cpp \
 					Button.cpp ChapterAbout.cpp Chapters.cpp CircleText.cpp platform.cpp \
-					FormatText.cpp Settings.cpp Tutorial.cpp Sound.cpp 
+					FormatText.cpp Settings.cpp Tutorial.cpp Sound.cpp ThreadPool.cpp Arena.cpp Replay.cpp Snapshot.cpp WorldState.cpp SteeringField.cpp Profiler.cpp 
 					
 LOCAL_STATIC_LIBRARIES := libzip libpng libfreetype libvorbis libogg libopenal 
 
@@ -0,0 +1,142 @@
+/*  
+	Copyright (c) 2012, Alexey Saenko
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/ 
+
+#include "Arena.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <new>
+
+static const int maxSpins = 64;		// a holder that takes longer was likely preempted
+
+// the lock is held for a few instructions, but the world's workers may outnumber the cores,
+// so a waiter gives its time slice away rather than spin through the holder's
+class ArenaLock {
+	volatile int &lock;
+public:
+	ArenaLock(volatile int &l): lock(l) {
+		for(int spins = 0; __sync_lock_test_and_set(&lock, 1); ++spins)
+			if(spins >= maxSpins)
+				sched_yield();
+	}
+	~ArenaLock()						{	__sync_lock_release(&lock);	}
+};
+
+Arena::Arena(): curChunk(0), curOffset(0), lock(0) {
+	memset(freeLists, 0, sizeof(freeLists));
+	memset(&stats, 0, sizeof(stats));
+}
+
+Arena::~Arena() {
+	for(int c = chunkShift - minShift + 1; c < classCount; ++c)
+		while(freeLists[c]) {
+			FreeBlock *b = freeLists[c];
+			freeLists[c] = b->next;
+			free(b);
+		}
+	for(std::vector<char*>::iterator c = chunks.begin(); c != chunks.end(); ++c)
+		free(*c);
+}
+
+void* ArenaObject::operator new(size_t size, Arena &a) {
+	char *p = (char*)a.allocate(size + headerSize);
+	Header *h = (Header*)p;
+	h->arena = &a;
+	h->size = size + headerSize;
+	return p + headerSize;
+}
+
+void ArenaObject::operator delete(void *p) {
+	if(!p)
+		return;
+	Header *h = (Header*)((char*)p - headerSize);
+	h->arena->deallocate(h, h->size);
+}
+
+int Arena::sizeClass(size_t size) {
+	int c = 0;
+	size = (size - 1) >> minShift;
+	while(size) {
+		size >>= 1;
+		c++;
+	}
+	return c;
+}
+
+char* Arena::carve(size_t size) {
+	const size_t chunkSize = size_t(1) << chunkShift;
+	while(curChunk < chunks.size() && curOffset + size > chunkSize) {
+		curChunk++;
+		curOffset = 0;
+	}
+	if(curChunk == chunks.size()) {
+		char *c = (char*)malloc(chunkSize);
+		if(!c)
+			throw std::bad_alloc();
+		chunks.push_back(c);
+		stats.reserved += chunkSize;
+		stats.heapAllocs++;
+	}
+	char *p = chunks[curChunk] + curOffset;
+	curOffset += size;
+	return p;
+}
+
+void* Arena::allocate(size_t size) {
+	int c = sizeClass(size ? size : 1);
+	size_t blockSize = size_t(1) << (c + minShift);
+
+	ArenaLock l(lock);
+	stats.allocs++;
+	stats.used += blockSize;
+	if(stats.used > stats.peak)
+		stats.peak = stats.used;
+
+	if(FreeBlock *b = freeLists[c]) {
+		freeLists[c] = b->next;
+		return b;
+	}
+	if(c + minShift <= chunkShift)
+		return carve(blockSize);
+
+	void *p = malloc(blockSize);
+	if(!p)
+		throw std::bad_alloc();
+	stats.reserved += blockSize;
+	stats.heapAllocs++;
+	return p;
+}
+
+void Arena::deallocate(void *p, size_t size) {
+	if(!p)
+		return;
+	int c = sizeClass(size ? size : 1);
+
+	ArenaLock l(lock);
+	stats.frees++;
+	stats.used -= size_t(1) << (c + minShift);
+	FreeBlock *b = (FreeBlock*)p;
+	b->next = freeLists[c];
+	freeLists[c] = b;
+}
+
+void Arena::reset() {
+	ArenaLock l(lock);
+	for(int c = 0; c <= chunkShift - minShift; ++c)		// these live in the chunks, big blocks stay for the next level
+		freeLists[c] = 0;
+	curChunk = 0;
+	curOffset = 0;
+	stats.used = 0;
+}
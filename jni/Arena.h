@@ -0,0 +1,112 @@
+/*  
+	Copyright (c) 2012, Alexey Saenko
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/ 
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <vector>
+#include <new>
+
+// Level scoped memory for trees, links and their buffers, every WorldState owns one.
+// Blocks are rounded up to a power of two and recycled through per size freelists,
+// small ones are carved from big chunks which are rewound at once by reset().
+class Arena {
+	enum {
+		minShift = 4,					// 16 bytes
+		classCount = 27,				// up to 1 GB
+		chunkShift = 18					// 256 KB, bigger blocks are taken from the heap one by one
+	};
+	struct FreeBlock {
+		FreeBlock	*next;
+	};
+
+	std::vector<char*>	chunks;
+	size_t		curChunk, curOffset;
+	FreeBlock	*freeLists[classCount];
+	volatile int	lock;
+
+	static	int		sizeClass(size_t size);
+			char*	carve(size_t size);
+public:
+	struct Stats {
+		size_t			reserved, used, peak;	// bytes held from the heap, handed out now and at most
+		unsigned long	allocs, frees, heapAllocs;
+	};
+private:
+	Stats	stats;
+
+			Arena(const Arena&);
+	Arena&	operator=(const Arena&);
+public:
+			Arena();
+			~Arena();
+
+	void*	allocate(size_t size);
+	void	deallocate(void *p, size_t size);
+	void	reset();					// forgets every block, the level must be gone by then
+	const Stats&	getStats()			{	return stats;	}
+};
+
+// Base of the level objects, created by new(arena) T(...). Each keeps its arena and size
+// in front of it, so delete finds them.
+class ArenaObject {
+	enum {	headerSize = 16	};		// keeps the object aligned for any member
+	struct Header {
+		Arena	*arena;
+		size_t	size;
+	};
+public:
+	static	void*	operator new(size_t size, Arena &a);
+	static	void	operator delete(void *p);
+	static	void	operator delete(void *p, Arena &a)		{	operator delete(p);	}		// a throwing constructor
+};
+
+// STL allocator for containers owned by level objects, they are given the arena of their level
+template<class T>
+class ArenaAllocator {
+	template<class U> friend class ArenaAllocator;
+	Arena	*arena;
+public:
+	typedef T			value_type;
+	typedef T*			pointer;
+	typedef const T*	const_pointer;
+	typedef T&			reference;
+	typedef const T&	const_reference;
+	typedef size_t		size_type;
+	typedef ptrdiff_t	difference_type;
+
+	template<class U> struct rebind {
+		typedef ArenaAllocator<U> other;
+	};
+
+	explicit ArenaAllocator(Arena &a): arena(&a)	{}
+	ArenaAllocator(const ArenaAllocator &a): arena(a.arena)		{}
+	template<class U> ArenaAllocator(const ArenaAllocator<U> &a): arena(a.arena)	{}
+
+	pointer			address(reference x) const				{	return &x;	}
+	const_pointer	address(const_reference x) const		{	return &x;	}
+	size_type		max_size() const						{	return size_type(1 << 30) / sizeof(T);	}
+
+	pointer	allocate(size_type n, const void* = 0)			{	return n ? (pointer)arena->allocate(n * sizeof(T)) : 0;	}
+	void	deallocate(pointer p, size_type n)				{	if(p) arena->deallocate(p, n * sizeof(T));	}
+	void	construct(pointer p, const T& val)				{	new((void*)p) T(val);	}
+	void	destroy(pointer p)								{	p->~T();	}
+
+	bool	operator==(const ArenaAllocator &a) const		{	return arena == a.arena;	}
+	bool	operator!=(const ArenaAllocator &a) const		{	return arena != a.arena;	}
+};
+
+#endif
@@ -35,6 +35,7 @@ class Button: public Control {
 public:
 					Button(const vec2& pos, float r, const char* text, const color4& c1, const color4 &c2, ClickEvent *e=0);
 	virtual	void	onClick();
+			void	setText(const char* text)	{	ctext.setText(text);	}
 	virtual	void	draw(Render& render);
 };
 
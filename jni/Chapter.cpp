@@ -19,12 +19,21 @@
 #include "Chapters.h"
 #include "ChapterAbout.h"
 #include "Settings.h"
+#include "platform.h"
+#include "Profiler.h"
+#include <stdio.h>
 
 static const float fadeStep = 0.05f;
 static const float defaultCursorSize = 0.25f * 160;		//  1/4 inch, 160dpi - default logical density
+static const int defaultTickRate = 60;
+static const int maxTicksPerFrame = 5;
+static const char *snapshotFile = "snapshot";
 
-Main::Main(const char *resourceFile): windowWidth(0), windowHeight(0), mouseX(0), mouseY(0), suspended(false), curChapter(0), toChapter(0), density(1.0f), chapterFade(0), finish(false) {
+Main::Main(const char *resourceFile): windowWidth(0), windowHeight(0), mouseX(0), mouseY(0), suspended(false), curChapter(0), toChapter(0), density(1.0f), chapterFade(0), finish(false), tickAccumulator(0) {
 	cursorSize = 0;		// for PC mouse
+	setTickRate(defaultTickRate);
+	lastTicks = platform::getTicks();
+	pthread_mutex_init(&updateMutex, 0);
 
 	ResourceManager::init(resourceFile);
 	Settings::instance();
@@ -34,14 +43,22 @@ Main::Main(const char *resourceFile): windowWidth(0), windowHeight(0), mouseX(0)
 	mp.addToPlayList("assets/music/theme2.ogg");
 	mp.changeMusic();
 
-	add(new World());
+	World *world = new World();
+	add(world);
 	add(new MainMenu());
 	add(new ChapterPause());
 	add(new ChapterLevelCompleted());
 	add(new ChapterLevelFailed());
 	add(new ChapterAbout());
 	add(new ChapterGameOver());
-	setCurrent(CID_MAINMENU, true);
+
+	std::string snapshot = platform::getDataPath(snapshotFile);		// left by a process killed in the background
+	if(world->loadSnapshot(snapshot.c_str())) {
+		world->pause();					// onShow() goes on with a paused level instead of loading it
+		setCurrent(world, false);
+	} else
+		setCurrent(CID_MAINMENU, true);
+	remove(snapshot.c_str());
 }
 
 Main::~Main() {
@@ -51,6 +68,8 @@ Main::~Main() {
 	Sound::destroy();
 	MusicPlayer::destroy();
 	ResourceManager::destroy();
+	Profiler::destroy();
+	pthread_mutex_destroy(&updateMutex);
 }
 
 void Main::add(Chapter *c) {
@@ -145,6 +164,13 @@ void Main::touchEnded(int id) {
 void Main::keyDown(int kid) {
 	if(suspended)
 		return;
+#if USE_PROFILER_KEY
+	if(kid == PROFILER_KEY_ID) {			// the overlay shows while the profiler runs
+		Profiler::setEnabled(!Profiler::isEnabled());
+		Profiler::instance().reset();
+		return;
+	}
+#endif
 	if(curChapter)
 		curChapter->keyDown(kid);
 }
@@ -166,12 +192,38 @@ void Main::draw() {
 	}	
 
 	if(curChapter) {
-		curChapter->update();
+		ProfileTimer pt(PP_FRAME);
+		pthread_mutex_lock(&updateMutex);
+		update();
+		pthread_mutex_unlock(&updateMutex);
+		Render::instance().setTickAlpha(tickAccumulator / tickTime);
 		curChapter->draw();
 		if(chapterFade > 0) {
 			Render &render = Render::instance();
 			render.fade(chapterFade);
 		}
+		pt.stop();
+		if(Profiler::isEnabled())
+			Render::instance().drawProfiler();
+	}
+}
+
+void Main::update() {		// fixed timestep: the chapter ticks at tickTime whatever the frame rate is
+	unsigned int t = platform::getTicks();
+	tickAccumulator += t - lastTicks;
+	lastTicks = t;
+	if(getCurrent() == CID_GAME && ((World*)curChapter)->isSkipping()) {		// it ticks for its own time budget, once a frame
+		curChapter->update();
+		tickAccumulator = 0;
+		return;
+	}
+	for(int i=0; tickAccumulator >= tickTime; ++i) {
+		if(i == maxTicksPerFrame) {		// too slow device, let the game slow down
+			tickAccumulator = 0;
+			break;
+		}
+		curChapter->update();
+		tickAccumulator -= tickTime;
 	}
 }
 
@@ -195,14 +247,23 @@ void Main::release() {
 	Render::release();
 }
 
+// the level is written out in case the process does not come back
 void Main::suspend() {
 	suspended = true;
+	int cid = getCurrent();
+	if(cid == CID_GAME || cid == CID_PAUSE) {
+		pthread_mutex_lock(&updateMutex);
+		((World*)getChapter(CID_GAME))->saveSnapshot(platform::getDataPath(snapshotFile).c_str());
+		pthread_mutex_unlock(&updateMutex);
+	}
 	MusicPlayer::instance().suspend();
 }
 
 void Main::resume() {
+	remove(platform::getDataPath(snapshotFile).c_str());
 	MusicPlayer::instance().resume();
 	suspended = false;
+	lastTicks = platform::getTicks();
 }
 
 Chapter::Chapter(int aid): id(aid), main(0), viewMat(1.0f), width(0), height(0), aspect(1), curControl(0) {
@@ -17,14 +17,27 @@
 #define CHAPTER_H
 
 #include <vector>
+#include <pthread.h>
 #include "math2d.h"
 
 #ifdef WIN32
 	#define USE_MOUSE 1
 	#define BACK_KEY_ID 0
+	#define PROFILER_KEY_ID 96		// `
 #elif defined(ANDROID)
 	#define USE_MOUSE 0
 	#define BACK_KEY_ID 4
+	#define PROFILER_KEY_ID 82		// menu
+#elif defined(__linux__)
+	#define USE_MOUSE 1
+	#define BACK_KEY_ID 27
+	#define PROFILER_KEY_ID 96
+#endif
+
+#if defined(_DEBUG) || defined(PROFILE_BUILD)
+	#define USE_PROFILER_KEY	1		// release builds ship without the profiler toggle
+#else
+	#define USE_PROFILER_KEY	0
 #endif
 
 class Chapter;
@@ -40,8 +53,12 @@ class Main {
 	Chapter	*curChapter, *toChapter;
 	bool	finish;
 	float	chapterFade;
+	float	tickTime, tickAccumulator;		// msec
+	unsigned int lastTicks;
+	pthread_mutex_t	updateMutex;			// the game is updated on the GL thread and saved on suspend
 	void	add(Chapter *c);
 	void	setCurChapter(Chapter *c);
+	void	update();
 public:
 			Main(const char *resourceFile);
 			~Main();
@@ -56,6 +73,7 @@ public:
 	void	suspend();
 	void	resume();
 	bool	isSuspended()			{	return suspended;	}
+	void	setTickRate(int ticksPerSecond)	{	tickTime = 1000.0f / ticksPerSecond;	}
 	void	touchBegan(int id, int x, int y);
 	void	touchMove(int id, int x, int y);
 	void	touchEnded(int id);
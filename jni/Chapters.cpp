@@ -16,6 +16,7 @@
 #include "Chapters.h"
 #include "World.h"
 #include "Render.h"
+#include "utils.h"
 
 ChapterSShot::ChapterSShot(int aid, const color4& c, const char *txt, const color4& tc): Chapter(aid), text(txt), color(c), textColor(tc), menuButton(0), fadeStep(0.02f) {
 }
@@ -70,24 +71,39 @@ ChapterSShot2::ChapterSShot2(int aid, const color4& c, const char *txt, const co
 
 ChapterPause::ChapterPause(): ChapterSShot2(CID_PAUSE, color4(0.7f,0.7f,0.7f,0), "PAUSE", color4(1,0.25f,0.0f,1)) {
 	add( okButton = new Button(vec2(0.8f, -0.63f), 0.25f, "Continue", color4(0.3f,0.05f,0.05f,1), color4(0.75f,0.5f,0.1f,1), this) );
+	add( speedButton = new Button(vec2(0.3f, -0.75f), 0.15f, "Faster", color4(0.3f,0.05f,0.05f,1), color4(0.75f,0.5f,0.1f,1), this) );
+	add( skipButton = new Button(vec2(0.62f, -0.2f), 0.15f, " Skip ", color4(0.3f,0.05f,0.05f,1), color4(0.75f,0.5f,0.1f,1), this) );
 	fadeStep = 0.04f;
 }
 
 void ChapterPause::onShow() {
 	ChapterSShot::onShow();
+	World *world = (World*)main->getChapter(CID_GAME);
+	speedButton->setText(("x" + to_string(world->getTimeScale())).c_str());
 	state = ST_FADE_IN;
 }
 
+// speed goes 1x, 2x, 4x, 8x and back to 1x, all buttons continue the game, Continue at the normal pace
 void ChapterPause::onClick(Control *c) {
-	if(c == okButton)
+	World *world = (World*)main->getChapter(CID_GAME);
+	if(c == speedButton) {
+		world->setTimeScale(world->getTimeScale() < 8 ? world->getTimeScale() * 2 : 1);
 		state = ST_FADE_OUT;
-	else 
+	} else if(c == skipButton) {
+		world->skipToOutcome();
+		state = ST_FADE_OUT;
+	} else if(c == okButton) {
+		world->stopSkipping();
+		state = ST_FADE_OUT;
+	} else 
 		ChapterSShot::onClick(c);
 }
 
 void ChapterPause::keyDown(int kid) {
-	if(kid == BACK_KEY_ID)
+	if(kid == BACK_KEY_ID) {
+		((World*)main->getChapter(CID_GAME))->stopSkipping();
 		state = ST_FADE_OUT;
+	}
 }
 
 void ChapterPause::update() {
@@ -51,6 +51,7 @@ class ChapterPause: public ChapterSShot2 {
 		ST_FADE_OUT
 	};
 	State	state;
+	Button	*speedButton, *skipButton;
 
 	virtual	void	onClick(Control *c);
 	virtual	void	keyDown(int kid);
@@ -19,6 +19,12 @@
 #include "utf8/unchecked.h"
 
 CircleText::CircleText(const vec2& p, float r, const char* t): pos(p), radius(r), fontSize(0) {
+	setText(t);
+}
+
+void CircleText::setText(const char* t) {
+	text.clear();
+	fontSize = 0;			// fitted again on the next draw
 	const char *start = t;
 	for(;;) {
 		unsigned int cp=utf8::unchecked::next(t);
@@ -29,6 +29,7 @@ class CircleText {
 	std::vector<std::string>	text;
 public:
 			CircleText(const vec2& pos, float r, const char* text);
+	void	setText(const char* text);
 	void	draw(Render& render, const mat4& transform, const color4 &col);
 	float	getRadius()		{	return radius;	}
 	vec2	getPos()		{	return pos;		}
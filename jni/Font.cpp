@@ -175,7 +175,7 @@ bool FontMaker::drawGlyph(unsigned int ch, Font *font) {
 								     (face->glyph->advance.x >> 6) * s) );
 
 	posX += bitmap.width + 2;
-	sweepY = std::max(sweepY, posY + bitmap.rows + 2);
+	sweepY = std::max(sweepY, posY + (int)bitmap.rows + 2);
 
 	FT_Done_Glyph( glyph );
 	return true;
@@ -16,9 +16,10 @@
 #include "Genus.h"
 #include "Tree.h"
 #include "Planet.h"
+#include "WorldState.h"
 #include <algorithm>
 
-Genus::Genus(const color4 &c, 
+Genus::Genus(WorldState &ws, const color4 &c, 
 				float gFactor, float a_weakness, float lFactor, float lenBallance,
 				float l_up, float lFactor_up,  float lFactorDiv_up,    float aFactor_up,   float aFactorDiv_up,
 				float l_down, float lFactor_down, float lFactorDiv_down, float aFactor_down, float aFactorDiv_down): 
@@ -26,8 +27,60 @@ Genus::Genus(const color4 &c,
 	lengthFactor_up(lFactor_up),  lengthFactorDiv_up(lFactorDiv_up), angleFactor_up(aFactor_up), angleFactorDiv_up(aFactorDiv_up),
 	lengthFactor_down(lFactor_down), lengthFactorDiv_down(lFactorDiv_down), angleFactor_down(aFactor_down), angleFactorDiv_down(aFactorDiv_down)
 {
-	index = genuses.size();
-	genuses.push_back(this);
+	index = ws.genuses.size();
+	ws.genuses.push_back(this);
+}
+
+Genus* Genus::load(WorldState &ws, SnapshotReader &s) {
+	Genus *g = new Genus(ws, color4(0, 0, 0), 1.0f, 1.0f, 1.0f, 1.0f, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+	s.get(g->color);
+	s.get(g->growingFactor);
+	s.get(g->weakness);
+	s.get(g->linkFactor);
+	s.get(g->lengthBallance);
+	s.get(g->length_up);
+	s.get(g->length_down);
+	s.get(g->lengthFactor_up);
+	s.get(g->lengthFactorDiv_up);
+	s.get(g->angleFactor_up);
+	s.get(g->angleFactorDiv_up);
+	s.get(g->lengthFactor_down);
+	s.get(g->lengthFactorDiv_down);
+	s.get(g->angleFactor_down);
+	s.get(g->angleFactorDiv_down);
+	return g;
+}
+
+void Genus::save(SnapshotWriter &s) {
+	s.put(color);
+	s.put(growingFactor);
+	s.put(weakness);
+	s.put(linkFactor);
+	s.put(lengthBallance);
+	s.put(length_up);
+	s.put(length_down);
+	s.put(lengthFactor_up);
+	s.put(lengthFactorDiv_up);
+	s.put(angleFactor_up);
+	s.put(angleFactorDiv_up);
+	s.put(lengthFactor_down);
+	s.put(lengthFactorDiv_down);
+	s.put(angleFactor_down);
+	s.put(angleFactorDiv_down);
+}
+
+void Genus::saveTrees(SnapshotWriter &s, const SnapshotTable<Tree> &all) {
+	s.put((unsigned int)trees.size());
+	for(std::vector<Tree*>::iterator t = trees.begin(); t != trees.end(); ++t)
+		s.put(all.find(*t));
+}
+
+void Genus::loadTrees(SnapshotReader &s, const SnapshotTable<Tree> &all) {
+	trees.clear();
+	unsigned int count = s.get<unsigned int>();
+	for(unsigned int i=0; i<count && !s.failed(); ++i)
+		if(Tree *t = all.get(s.get<int>()))
+			trees.push_back(t);
 }
 
 void Genus::clear() {
@@ -46,5 +99,3 @@ void Genus::remove(Tree *t) {
 		trees.pop_back();
 	}
 }
-
-std::vector<Genus*> genuses;
@@ -17,10 +17,12 @@
 #define GENUS_H
 
 #include "color.h"
+#include "Snapshot.h"
 #include <vector>
 
 class Tree;
 class Planet;
+class WorldState;
 
 class Genus {
 friend class Tree;
@@ -35,16 +37,18 @@ friend class Mind;
 	void	add(Tree* t);
 	void	remove(Tree* t);
 public:
-			Genus(const color4 &c, float gFactor, float weakness, float lFactor, float lenBallance, 
+			Genus(WorldState &ws, const color4 &c, float gFactor, float weakness, float lFactor, float lenBallance, 
 				float l_up, float lengthFactor_up,  float lengthFactorDiv_up,    float angleFactor_up,   float angleFactorDiv_up,
 				float l_down, float lengthFactor_down, float lengthFactorDiv_down, float angleFactor_down, float angleFactorDiv_down);
+	static	Genus*	load(WorldState &ws, SnapshotReader &s);
+	void	save(SnapshotWriter &s);
+	void	saveTrees(SnapshotWriter &s, const SnapshotTable<Tree> &all);
+	void	loadTrees(SnapshotReader &s, const SnapshotTable<Tree> &all);
 	color4	getColor()		{	return color;	}
 	int		getIndex()		{	return index;	}
 	bool	eliminated()	{	return trees.empty();	}
 	void	clear();
 };
 
-extern std::vector<Genus*>	genuses;
-
 
 #endif
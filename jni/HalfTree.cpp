@@ -20,62 +20,92 @@
 #include "Texture.h"
 #include "Render.h"
 
-HalfTree::Node::~Node() {
-	if(parent) {
-		if(parent->left==this) 
-			parent->left=0;
-		else
-			parent->right=0;
-	}
+static inline unsigned int reverseBits(unsigned int v, int bits) {
+	v = ((v >> 1) & 0x55555555) | ((v & 0x55555555) << 1);
+	v = ((v >> 2) & 0x33333333) | ((v & 0x33333333) << 2);
+	v = ((v >> 4) & 0x0F0F0F0F) | ((v & 0x0F0F0F0F) << 4);
+	v = ((v >> 8) & 0x00FF00FF) | ((v & 0x00FF00FF) << 8);
+	v = (v >> 16) | (v << 16);
+	return bits ? v >> (32 - bits) : 0;
 }
 
-HalfTree::HalfTree(const vec2 &p, const vec2 &d, float l, float lFactor, float lFactorDiv, float aFactor, float aFactorDiv, Deformer *def): 
-				bounds(p, p), deformer(def), root(0), current(0), count(0), deep(0), length(0), iterator(0), maxIterator(0), 
-				invStatus(IS_ALL),
-				lengthFactor(lFactor), lengthFactorDiv(lFactorDiv), angleFactor(aFactor), angleFactorDiv(aFactorDiv) 
+HalfTree::HalfTree(Arena &a, const vec2 &p, const vec2 &d, float l, float lFactor, float lFactorDiv, float aFactor, float aFactorDiv, Deformer *def, unsigned int seed): 
+				bounds(p, p), prevBounds(ArenaAllocator<rect>(a)), deformer(def), random(seed), 
+				lengthFactor(lFactor), lengthFactorDiv(lFactorDiv), angleFactor(aFactor), angleFactorDiv(aFactorDiv), nodes(ArenaAllocator<Node>(a)), 
+				count(0), deep(0), length(0), current(-1), prevCurrent(-1), prevCurLength(0), drawnLength(0), iterator(0), maxIterator(0), 
+				verts(ArenaAllocator<TreeVert>(a)), invStatus(IS_ALL)
 {
-	root = new Node(p, d, l, 0);
+	nodes.push_back(Node(p, d, l));
+	bounds.add(nodes[0].end());
+}
+
+HalfTree::HalfTree(Arena &a, SnapshotReader &s, Deformer *def): prevBounds(ArenaAllocator<rect>(a)), deformer(def), nodes(ArenaAllocator<Node>(a)), 
+				drawnLength(0), verts(ArenaAllocator<TreeVert>(a)), invStatus(IS_REBUILD) {
+	s.get(bounds);
+	s.getVector(prevBounds);
+	s.get(random);
+	s.get(lengthFactor);
+	s.get(lengthFactorDiv);
+	s.get(angleFactor);
+	s.get(angleFactorDiv);
+	s.getVector(nodes);
+	s.get(count);
+	s.get(deep);
+	s.get(length);
+	s.get(current);
+	s.get(prevCurrent);
+	s.get(prevCurLength);
+	s.get(iterator);
+	s.get(maxIterator);
+}
+
+void HalfTree::save(SnapshotWriter &s) {
+	s.put(bounds);
+	s.putVector(prevBounds);
+	s.put(random);
+	s.put(lengthFactor);
+	s.put(lengthFactorDiv);
+	s.put(angleFactor);
+	s.put(angleFactorDiv);
+	s.putVector(nodes);
+	s.put(count);
+	s.put(deep);
+	s.put(length);
+	s.put(current);
+	s.put(prevCurrent);
+	s.put(prevCurLength);
+	s.put(iterator);
+	s.put(maxIterator);
+}
+
+// branches grow level by level, the bits of iterator are the turns from the root (lowest bit first)
+inline int HalfTree::nodeIndex(int iterator, int deep) {
+	return (1 << deep) - 1 + reverseBits(iterator, deep);
 }
 
-inline HalfTree::Node *HalfTree::makeNode(const vec2 &pos, const vec2 &dir, float length, Node *parent) {
+inline void HalfTree::makeNode(int idx, const vec2 &pos, const vec2 &dir, float length) {
 	if(deformer) {
 		vec2 p = pos + dir * length;
 		if(deformer->deform(p)) {
 			p -= pos;
 			length = p.fast_normalize();
-			return new Node(pos, p, length, parent);
+			nodes[idx] = Node(pos, p, length);
+			return;
 		}
 	}
-	return new Node(pos, dir, length, parent);
-}
-
-HalfTree::Node *HalfTree::makeLeft(HalfTree::Node *n) {
-	n->left = makeNode(n->end(), mat2::get_rotate( angleFactor * randf(1, angleFactorDiv)) * n->dir, n->length * lengthFactor * randf(1, lengthFactorDiv), n);
-	bounds.add( n->left->end() );
-	return n->left;
-}
-
-HalfTree::Node *HalfTree::makeRight(HalfTree::Node *n) {
-	n->right = makeNode(n->end(), mat2::get_rotate(-angleFactor * randf(1, angleFactorDiv)) * n->dir, n->length * lengthFactor * randf(1, lengthFactorDiv), n);
-	bounds.add( n->right->end() );
-	return n->right;
-}
-
-void HalfTree::addBounds(HalfTree::Node *n) {
-	bounds.add(n->end());
-	if(n->left)
-		addBounds(n->left);
-	if(n->right)
-		addBounds(n->right);
+	nodes[idx] = Node(pos, dir, length);
 }
 
-void HalfTree::recalcBounds() {
-	bounds = rect(root->pos, root->pos);
-	addBounds(root);
+void HalfTree::makeBranch(int idx) {
+	Node &n = nodes[(idx-1) >> 1];
+	float angle = (idx & 1) ? angleFactor : -angleFactor;		// odd index is the left child
+	makeNode(idx, n.end(), mat2::get_rotate(angle * random.randf(1, angleFactorDiv)) * n.dir, n.length * lengthFactor * random.randf(1, lengthFactorDiv));
+	prevBounds.push_back(bounds);
+	bounds.add( nodes[idx].end() );
 }
 
 float HalfTree::getLength() {
-	return current ? length + current->curLength : length;
+	return current >= 0 ? length + nodes[current].curLength : length;
 }
 
 void HalfTree::invalidate(InvalidateStatus invSt) {
@@ -83,16 +113,17 @@ void HalfTree::invalidate(InvalidateStatus invSt) {
 }
 
 void HalfTree::stepUp(float v) {
-	if(!current) {
+	if(current < 0) {
 		leftBranch();
 		count++;
 		invalidate(IS_ALL);
 	}
 
-	current->curLength += v;
-	if(current->curLength >= current->length) {
-		current->curLength = current->length;
-		length += current->length;
+	Node &c = nodes[current];
+	c.curLength += v;
+	if(c.curLength >= c.length) {
+		c.curLength = c.length;
+		length += c.length;
 		nextBranch();
 		count++;
 		invalidate(IS_ALL);
@@ -100,22 +131,47 @@ void HalfTree::stepUp(float v) {
 		invalidate(IS_LAST_POINT);
 }
 
+// the branches stepUp() would add one per call, made in one pass and drawn once
+void HalfTree::growTo(float len) {
+	if(getLength() >= len)
+		return;
+	if(current < 0) {
+		leftBranch();
+		count++;
+	}
+	for(;;) {
+		Node &c = nodes[current];
+		float rest = len - length;
+		if(c.length > rest) {
+			c.curLength = rest;
+			break;
+		}
+		c.curLength = c.length;
+		length += c.length;
+		nextBranch();
+		count++;
+	}
+	invalidate(IS_ALL);
+}
+
 void HalfTree::stepDown(float v) {
 	if(count==0) 
 		return;
 
-	current->curLength -= v;
-	if(current->curLength <= 0) {
+	nodes[current].curLength -= v;
+	if(nodes[current].curLength <= 0) {
 		count--;
 		if(count==0) {
-			current = 0;
+			current = -1;
 			length = 0;
 			return;
 		}
-		delete current;
-		recalcBounds();
+		if(prevCurrent == current)
+			prevCurrent = -1;
 		prevBranch();
-		length -= current->length;
+		bounds = prevBounds.back();
+		prevBounds.pop_back();
+		length -= nodes[current].length;
 		invalidate(IS_ALL);
 	} else
 		invalidate(IS_LAST_POINT);
@@ -124,15 +180,14 @@ void HalfTree::stepDown(float v) {
 
 void HalfTree::leftBranch() {
 	iterator = 0;
-	current = root;
-	int deep = 0;
-	while(current->left) {
-		deep++;
-		current = current->left;
-	}
-	if(current->curLength >= current->length) {
-		deep++;
-		current = makeLeft(current);
+	deep = 0;
+	current = 0;
+	if(nodes[0].curLength >= nodes[0].length) {
+		deep = 1;
+		if(nodes.size() < 3)
+			nodes.resize(3);
+		current = 1;
+		makeBranch(current);
 	}
 	maxIterator = (1 << deep);
 }
@@ -143,23 +198,11 @@ void HalfTree::nextBranch() {
 		maxIterator <<= 1;
 		deep++;
 		iterator = 0;
+		if((int)nodes.size() < maxIterator*2 - 1)
+			nodes.resize(maxIterator*2 - 1);		// room for the whole new level at once
 	}
-	current = root;
-	int it = iterator;
-	for(int fit = maxIterator; !(fit & 1); fit >>= 1) {
-		if(it & 1) {
-			if(current->right)
-				current = current->right;
-			else 
-				current = makeRight(current);
-		} else {
-			if(current->left)
-				current = current->left;
-			else 
-				current = makeLeft(current);
-		}
-		it >>= 1;
-	}
+	current = nodeIndex(iterator, deep);
+	makeBranch(current);
 }
 
 void HalfTree::prevBranch() {
@@ -170,21 +213,13 @@ void HalfTree::prevBranch() {
 		deep--;
 		if(maxIterator <= 0) {
 			iterator = 0;
-			current = 0;
+			current = -1;
 			deep=0;
 			return;
 		}
 		iterator = maxIterator - 1;
 	} 
-	current = root;
-	int it = iterator;
-	for(int fit = maxIterator; !(fit & 1); fit >>= 1) {
-		if(it & 1) 
-			current = current->right;
-		else 
-			current = current->left;
-		it >>= 1;
-	}
+	current = nodeIndex(iterator, deep);
 }
 
 #if 0
@@ -224,12 +259,11 @@ void HalfTree::buildDrawBuffer() {
 
 	invStatus = IS_VALID;
 	vertCount = 0;
-	if(!root)
-		return;
 
+	Node &root = nodes[0];
 	float thickness = (deep + 1 + (float(iterator)/maxIterator) ) * 0.003f;
-	vec2 finish = root->pos + root->dir * root->curLength;	// root->left->pos
-	vec2 n = vec2(-root->dir.y, root->dir.x);
+	vec2 finish = root.pos + root.dir * root.curLength;	// root->left->pos
+	vec2 n = vec2(-root.dir.y, root.dir.x);
 
 	vec2 vn = n;// * (finish - root->pos).fast_length();
 
@@ -241,8 +275,8 @@ void HalfTree::buildDrawBuffer() {
 		setAllData = true;
 	}
 
-	verts[0] = TreeVert(root->pos-n, vn, 0);
-	verts[1] = TreeVert(root->pos+n, vn, 0);
+	verts[0] = TreeVert(root.pos-n, vn, 0);
+	verts[1] = TreeVert(root.pos+n, vn, 0);
 	verts[2] = TreeVert(finish-n, vn, 1);
 	verts[3] = TreeVert(finish+n, vn, 1);
 	vertCount = 4;
@@ -251,63 +285,53 @@ void HalfTree::buildDrawBuffer() {
 		vertSample = TreeVert(n, vn, 1);
 	} else {
 		float level = 1;
-		int mit = 2;
+		int mit = 2, d = 1;
 		for(int i = 0; (i <= iterator && mit == maxIterator) || mit < maxIterator;) {
-			current = root;
-			int it = i;
-			bool r;
-			int idx = 0;
-			for(int fit = mit; !(fit & 1); fit >>= 1) {
-				r = it & 1;
-				if(r) 
-					current = current->right;
-				else
-					current = current->left;
-				it >>= 1;
-				idx += fit >> 2;
-			}
-
+			int idx = nodeIndex(i, d);
 			int mask = (mit >> 1) - 1;
-			idx = ((i & mask)+1+idx)*3-1;	// index of parent
-			if(r) 
-				buildDrawBufferRight(current, idx, level, &verts[0]);
+			int pidx = ((i & mask)+1+mask)*3-1;	// index of parent
+			if(idx & 1) 
+				buildDrawBufferLeft(nodes[idx], pidx, level, &verts[0]);
 			else
-				buildDrawBufferLeft(current, idx, level, &verts[0]);
+				buildDrawBufferRight(nodes[idx], pidx, level, &verts[0]);
 
 			i++;
 			if(i >= mit) {
 				mit <<= 1;
+				d++;
 				i = 0;
 				level++;
 			}
 		}
 
 	}
+	drawnLength = current >= 0 ? nodes[current].curLength : 0;
 	if(setAllData) 
 		vertsVBO.setData(verts.size() * sizeof(TreeVert), GL_DYNAMIC_DRAW, &verts[0]);
 	else
 		vertsVBO.setSubData(0, vertCount * sizeof(TreeVert), &verts[0]);
 }
 			
-void HalfTree::updateDrawBufferLastPoint() {
-	if(!current) {
+void HalfTree::updateDrawBufferLastPoint(float len) {
+	if(current < 0) {
 		invStatus = IS_ALL;
 		return;
 	}
-	vec2 finish = current->pos + current->dir * current->curLength;	
+	drawnLength = len;
+	vec2 finish = nodes[current].pos + nodes[current].dir * len;	
 	TreeVert verts[2] = {	TreeVert(finish - vertSample.v, vertSample.n, vertSample.lev),
 							TreeVert(finish + vertSample.v, vertSample.n, vertSample.lev)	};  
 	vertsVBO.setSubData((vertCount-2)*sizeof(TreeVert), sizeof(verts), verts);
 	invStatus = IS_VALID;
 }
 
-void HalfTree::buildDrawBufferLeft(Node *nd, int idx, float level, TreeVert* verts) {
-	vec2 p = nd->pos + nd->dir * (nd->dir * (verts[idx+1].v - nd->pos));
+void HalfTree::buildDrawBufferLeft(Node &nd, int idx, float level, TreeVert* verts) {
+	vec2 p = nd.pos + nd.dir * (nd.dir * (verts[idx+1].v - nd.pos));
 	vec2 n = (verts[idx+1].v - p) * 0.75f;
 	vec2 pn = p - n;
 
-	vec2 finish = nd->pos + nd->dir * nd->curLength;	// root->left->pos
-	vec2 vn = n;// * (finish - nd->pos).fast_length();
+	vec2 finish = nd.pos + nd.dir * nd.curLength;	// root->left->pos
+	vec2 vn = n;// * (finish - nd.pos).fast_length();
 	vn.fast_normalize();
 
 	verts[vertCount] = TreeVert(pn, verts[idx+1].n, level);	vertCount++;
@@ -316,13 +340,13 @@ void HalfTree::buildDrawBufferLeft(Node *nd, int idx, float level, TreeVert* ver
 	vertSample = TreeVert(n, vn, level + 1);
 }
 
-void HalfTree::buildDrawBufferRight(Node *nd, int idx, float level, TreeVert* verts) {
-	vec2 p = nd->pos + nd->dir * (nd->dir * (verts[idx].v - nd->pos));
+void HalfTree::buildDrawBufferRight(Node &nd, int idx, float level, TreeVert* verts) {
+	vec2 p = nd.pos + nd.dir * (nd.dir * (verts[idx].v - nd.pos));
 	vec2 n = p - verts[idx].v;
 	vec2 pn = p + n;
 
-	vec2 finish = nd->pos + nd->dir * nd->curLength;	// root->left->pos
-	vec2 vn = n;// * (finish - nd->pos).fast_length();
+	vec2 finish = nd.pos + nd.dir * nd.curLength;	// root->left->pos
+	vec2 vn = n;// * (finish - nd.pos).fast_length();
 	vn.fast_normalize();
 
 	verts[vertCount] = TreeVert(pn, verts[idx].n, level);	vertCount++;
@@ -450,17 +474,14 @@ void HalfTree::draw(Render *render) {
 
 	vertsVBO.bind();
 
-	switch(invStatus) {
-		case IS_LAST_POINT:
-			updateDrawBufferLastPoint();
-			break;
-		case IS_ALL:
-		case IS_REBUILD:
-			buildDrawBuffer();
-			break;
-		default:
-			break;
-	}
+	if(invStatus == IS_ALL || invStatus == IS_REBUILD)
+		buildDrawBuffer();
+
+	float len = nodes[current].curLength;
+	if(current == prevCurrent)			// interpolate the growing end between the last two ticks
+		len = prevCurLength + (len - prevCurLength) * render->getTickAlpha();
+	if(invStatus == IS_LAST_POINT || len != drawnLength)
+		updateDrawBufferLastPoint(len);
 
 	render->bindPlantVBOIndex();
 
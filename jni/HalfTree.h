@@ -18,6 +18,9 @@
 
 #include "math2d.h"
 #include "VBO.h"
+#include "rand.h"
+#include "Arena.h"
+#include "Snapshot.h"
 #include <vector>
 
 class Render;
@@ -48,30 +51,34 @@ class HalfTree {
 	struct Node {
 		vec2 pos, dir;
 		float length, curLength;
-		Node *left, *right, *parent;
 
-				Node(const vec2 &p, const vec2 &d, float l, Node *par): pos(p), dir(d), length(l), curLength(0), left(0), right(0), parent(par) {}
-				~Node();
+				Node()	{}
+				Node(const vec2 &p, const vec2 &d, float l): pos(p), dir(d), length(l), curLength(0) {}
 		vec2	end()				{	return pos+dir*length;	}
 	};
 
 	rect	bounds;
+	std::vector<rect, ArenaAllocator<rect> >	prevBounds;	// bounds before each grown branch, restored on shrink
 	Deformer	*deformer;
+	Random	random;
 	float	lengthFactor, lengthFactorDiv, angleFactor, angleFactorDiv;
 
+	std::vector<Node, ArenaAllocator<Node> >	nodes;		// implicit binary tree, children of i are 2i+1 and 2i+2
 	int		count, deep;
 	float	length;
-	Node	*root, *current;
+	int		current;				// index of the growing node, -1 if none
+	int		prevCurrent;			// growing branch and its length at the previous tick
+	float	prevCurLength, drawnLength;
 	int		iterator, maxIterator;
 	void	leftBranch();
 	void	nextBranch();
 	void	prevBranch();
 
-	Node	*makeNode(const vec2 &pos, const vec2 &dir, float length, Node *parent);
-	Node	*makeLeft(Node *n);
-	Node	*makeRight(Node *n);
+	static	int	nodeIndex(int iterator, int deep);
+	void	makeNode(int idx, const vec2 &pos, const vec2 &dir, float length);
+	void	makeBranch(int idx);
 
-	std::vector<TreeVert>	verts;
+	std::vector<TreeVert, ArenaAllocator<TreeVert> >	verts;
 	VBOVertex	vertsVBO;
 
 	InvalidateStatus	invStatus;
@@ -80,26 +87,29 @@ class HalfTree {
 	void	invalidate(InvalidateStatus invSt);
 
 	void	buildDrawBuffer();
-	void	buildDrawBufferLeft(Node *n, int idx, float level, TreeVert* verts);
-	void	buildDrawBufferRight(Node *n, int idx, float level, TreeVert* verts);
-	void	updateDrawBufferLastPoint();
+	void	buildDrawBufferLeft(Node &n, int idx, float level, TreeVert* verts);
+	void	buildDrawBufferRight(Node &n, int idx, float level, TreeVert* verts);
+	void	updateDrawBufferLastPoint(float len);
 
-	void	addBounds(HalfTree::Node *n);
-	void	recalcBounds();
 public:
-			HalfTree(const vec2 &p, const vec2 &d, float l, float lengthFactor, float lengthFactorDiv, float angleFactor, float angleFactorDiv, Deformer *def=0);
+			HalfTree(Arena &a, const vec2 &p, const vec2 &d, float l, float lengthFactor, float lengthFactorDiv, float angleFactor, float angleFactorDiv, Deformer *def=0, unsigned int seed=1);
+			HalfTree(Arena &a, SnapshotReader &s, Deformer *def);
+	void	save(SnapshotWriter &s);
 	void	stepUp(float v);
 	void	stepDown(float v);
+	void	growTo(float len);
+	void	saveState()			{	prevCurrent = current; prevCurLength = current >= 0 ? nodes[current].curLength : 0;	}
 	int		getCount()			{	return count;		}
 	float	getLength();
-	vec2	getPos()			{	return root->pos;	}
-	vec2	getDir()			{	return root->dir;	}
+	vec2	getPos()			{	return nodes[0].pos;	}
+	vec2	getDir()			{	return nodes[0].dir;	}
 
 	void	draw(Render *render);
 	void	drawBounds(Render *render);
 
 	void	invalidate()		{	invalidate(IS_REBUILD);	}
 	static	void buildVBOIndex(VBOIndex &index);
+	static	size_t	getNodeSize()	{	return sizeof(Node);	}		// snapshots store the nodes as they are
 };
 
 #endif
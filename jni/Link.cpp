@@ -17,20 +17,86 @@
 #include "World.h"
 #include "Planet.h"
 #include "Tree.h"
+#include "WorldState.h"
 #include "opengl.h"
 #include "rand.h"
 #include <algorithm>
 
-static const int RECALC_BOUNDS_STRIDE = 10;
+static const float maxPathError = 0.0025f;		// half the drawn width, the path keeps this close to every growing step
 
-Link::Link(Tree *par, Planet *t): parent(par), leech(0), target(t), length(0), drawIndex(0),lastRecalcBounds(0), lastBuildBufferPointSize(0), age(0), verts(250) {
+static const TreeVert zeroVert(vec2(0, 0), vec2(0, 0), 0);
+
+static inline Arena& arenaOf(Tree *t) {
+	return t->getPlanet()->getWorldState().arena;
+}
+
+Link::Link(Tree *par, Planet *t): target(t), parent(par), leech(0), prevBounds(ArenaAllocator<rect>(arenaOf(par))), length(0), wave(0), 
+		drawIndex(0), lastBuildBufferPointSize(0), age(0), points(ArenaAllocator<vec2>(arenaOf(par))), levels(ArenaAllocator<float>(arenaOf(par))), 
+		sleeveMin(1.0f), sleeveMax(0.0f), verts(250, zeroVert, ArenaAllocator<TreeVert>(arenaOf(par))) {
 	current = parent->getPos();
 	dir = parent->getDir();
 	end = target->getGrowingPoint(parent->getRace(), current - target->getPos());
 	dist = (end - current).length();
-	points.push_back(current);
-	bounds.add(current);
+	addPoint(current);
+	prevTip = drawnTip = current;
 	state = LS_GROWING;
+	cutGrowing = false;
+	findPlanetLinks();
+}
+
+Link::Link(Tree *par, SnapshotReader &s, const SnapshotTable<Tree> &trees): parent(par), prevBounds(ArenaAllocator<rect>(arenaOf(par))), 
+		drawIndex(0), lastBuildBufferPointSize(0), points(ArenaAllocator<vec2>(arenaOf(par))), levels(ArenaAllocator<float>(arenaOf(par))), 
+		verts(250, zeroVert, ArenaAllocator<TreeVert>(arenaOf(par))) {
+	int t = s.get<int>();
+	std::vector<Planet*> &planets = parent->getPlanet()->getWorldState().planets;
+	target = t >= 0 && t < (int)planets.size() ? planets[t] : 0;
+	leech = trees.get(s.get<int>());
+	s.get(dir);
+	s.get(end);
+	s.get(current);
+	s.get(prevTip);
+	s.get(bounds);
+	s.getVector(prevBounds);
+	s.get(dist);
+	s.get(length);
+	s.get(wave);
+	s.get(age);
+	s.get(state);
+	s.getVector(points);
+	s.getVector(levels);
+	s.get(sleeveDir);
+	s.get(sleeveMin);
+	s.get(sleeveMax);
+	drawnTip = prevTip;
+	cutGrowing = false;		// snapshots are taken between ticks, no cut is pending then
+	findPlanetLinks();
+}
+
+void Link::findPlanetLinks() {
+	Planet *planet = parent->getPlanet();
+	planetLink = target ? planet->findLink(target) : -1;
+	targetLink = target ? target->findLink(planet) : -1;
+}
+
+void Link::save(SnapshotWriter &s, const SnapshotTable<Tree> &trees) {
+	s.put(target ? target->index : -1);
+	s.put(trees.find(leech));
+	s.put(dir);
+	s.put(end);
+	s.put(current);
+	s.put(prevTip);
+	s.put(bounds);
+	s.putVector(prevBounds);
+	s.put(dist);
+	s.put(length);
+	s.put(wave);
+	s.put(age);
+	s.put(state);
+	s.putVector(points);
+	s.putVector(levels);
+	s.put(sleeveDir);
+	s.put(sleeveMin);
+	s.put(sleeveMax);
 }
 
 Link::~Link() {
@@ -38,30 +104,70 @@ Link::~Link() {
 
 void Link::stepDown(float v) {
 	length -= v;
+	sleeveMin = 1.0f;			// the shortened segment is not stretched again
+	sleeveMax = 0.0f;
 	while(points.size() > 1) {
 		vec2 d = points.back() - points[points.size()-2]; 
 		float l = d.length();
 		if(l > v) {
 			points.back() -= d * (v/l);
+			levels.back() -= (levels.back() - levels[levels.size()-2]) * (v/l);
+			bounds = prevBounds.back();
+			bounds.add(points.back());
 			return;
 		} else {
 			points.pop_back();
-			if(lastRecalcBounds - points.size() > RECALC_BOUNDS_STRIDE) {
-				lastRecalcBounds = points.size();
-				recalcBounds();
-			}
+			levels.pop_back();
+			bounds = prevBounds.back();
+			prevBounds.pop_back();
 			v -= l;
 		}
 	}
 	length = 0;
 	points.clear();
+	levels.clear();
+	prevBounds.clear();
 	state = LS_DIED;
 }
 
-void Link::recalcBounds() {
-	bounds = rect();
-	for(std::vector<vec2>::iterator p = points.begin(); p!=points.end(); ++p)
-		bounds.add(*p);
+// Instead of adding a point the last segment is stretched to p while every point it swallows stays
+// within maxPathError of it. Each swallowed point narrows the directions allowed from the segment start.
+void Link::addPoint(const vec2 &p) {
+	float level = levels.empty() ? 0.0f : levels.back() + 1.0f;
+	size_t n = points.size();
+	if(n >= 2 && sleeveMin <= sleeveMax) {
+		vec2 db = points[n-1] - points[n-2], dp = p - points[n-2];
+		float lo = sleeveMin, hi = sleeveMax;
+		float lb = db.length();
+		if(lb > maxPathError) {
+			float a = atan2f(sleeveDir.x*db.y - sleeveDir.y*db.x, sleeveDir * db);
+			float spread = asinf(maxPathError / lb);
+			lo = std::max(lo, a - spread);
+			hi = std::min(hi, a + spread);
+		}
+		float a = atan2f(sleeveDir.x*dp.y - sleeveDir.y*dp.x, sleeveDir * dp);
+		if(lo <= a && a <= hi && dp * db >= lb * lb) {
+			sleeveMin = lo;
+			sleeveMax = hi;
+			points.back() = p;
+			levels.back() = level;
+			bounds = prevBounds.back();
+			bounds.add(p);
+			if(lastBuildBufferPointSize >= (int)n)
+				lastBuildBufferPointSize = n-1;		// the last segment is built again
+			return;
+		}
+	}
+	if(n >= 1) {
+		sleeveDir = p - points[n-1];
+		sleeveDir.normalize();
+		sleeveMin = -PI;
+		sleeveMax = PI;
+	}
+	points.push_back(p);
+	levels.push_back(level);
+	prevBounds.push_back(bounds);
+	bounds.add(p);
 }
 
 void Link::stepUp(float v) {
@@ -69,24 +175,17 @@ void Link::stepUp(float v) {
 	float dts = dt.normalize();
 	if(dts <= 2*v) {
 		length += dts;
-		points.push_back(end);
-		bounds.add(end);
+		addPoint(end);
 		state = LS_NORMAL;
-		for(std::vector<Tree*>::iterator t = target->trees.begin(); t != target->trees.end(); ++t)
-			if((*t)->getRace() == parent->getRace()) {
-				setLeech(*t);
-				return;
-			}
-		setLeech( Tree::build(parent->getRace(), target, 0, randVec2()) );
+		parent->getPlanet()->pendingLinks.push_back(this);		// the target tree is found in Planet::resolve()
 		return;
 	}
 
-	static float a = 0;
-	a += PI * v *0.5f;
-	if(a>2*PI) 
-		a -= 2*PI;
+	wave += PI * v *0.5f;
+	if(wave>2*PI) 
+		wave -= 2*PI;
 	float df = std::min(1.0f, dts/(target->radius*4.0f)); 
-	mat2 m = mat2::get_rotate( sinf(a)*deg2rad(20)*df );
+	mat2 m = mat2::get_rotate( sinf(wave)*deg2rad(20)*df );
 	dt = m*dt;
 
 	dir += dt * 0.5f;
@@ -94,23 +193,29 @@ void Link::stepUp(float v) {
 
 	vec2 pos = current + dir * v;
 	bool recalc = false;
-	for(std::vector<PlanetObject*>::iterator p = planetObjects.begin(); p != planetObjects.end(); ++p) {
-		PlanetObject *obj = *p;
-		vec2 delta = pos - obj->getPos();
-		float d = delta.normalize();
-		float r = obj->getRadius();
-		const float forceFactor = 2.0f;
-		float forceDist = forceFactor*r;
-		if(d > forceDist)
-			continue;
-		float force = (forceDist - d)/forceDist * v;
-		if(obj == target) {
-			vec2 dr = end - obj->getPos();
-			dr.normalize();
-			pos += delta * (std::max(0.0f, 0.5f+ dr * dir) * force);
-		} else
-			pos += delta * (force*1.25f);
-		recalc = true;
+	vec2 dr = end - target->getPos();
+	dr.normalize();
+	float targetFactor = std::max(0.0f, 0.5f + dr * dir);		// the target pulls the link round to its growing point
+	WorldState &ws = parent->getPlanet()->getWorldState();
+	if(!ws.steering.empty()) {
+		vec2 delta, push = ws.steering.sample(pos);
+		float f = steeringForce(target->getPos(), target->getRadius(), pos, delta);
+		push += delta * (f * (targetFactor - steeringObstacle));	// the field counts the target as an obstacle
+		if(push.length2() > 0) {
+			pos += push * v;
+			recalc = true;
+		}
+	} else {
+		SpatialGrid<PlanetObject>::Query q(ws.planetObjectsGrid, pos, 2.0f*v);		// pos drifts by up to ~1.25v per object
+		while(PlanetObject *obj = q.next()) {
+			vec2 delta;
+			float f = steeringForce(obj->getPos(), obj->getRadius(), pos, delta);
+			if(f <= 0)
+				continue;
+			float force = f * v;
+			pos += delta * (obj == target ? targetFactor * force : force * steeringObstacle);
+			recalc = true;
+		}
 	}
 	if(recalc) {
 		dir = pos - current;
@@ -123,9 +228,7 @@ void Link::stepUp(float v) {
 		current = pos;
 	}
 
-	points.push_back(current);
-	bounds.add(current);
-	lastRecalcBounds = points.size();
+	addPoint(current);
 }
 
 void Link::setLeech(Tree *t) {
@@ -133,16 +236,44 @@ void Link::setLeech(Tree *t) {
 	t->addSeeder(this);
 }
 
-void Link::cut() {
+void Link::attach() {
+	for(std::vector<Tree*>::iterator t = target->trees.begin(); t != target->trees.end(); ++t)
+		if((*t)->getRace() == parent->getRace()) {
+			setLeech(*t);
+			return;
+		}
+	vec2 dir = parent->getRandom().randVec2();
+	setLeech( Tree::build(parent->getRace(), target, 0, dir, parent->getRandom().next()) );
+}
+
+// deferred cuts only change the state, the other planets are updated later by resolve()
+void Link::cut(bool deferred) {
 	if(state == LS_DIED || state == LS_CUTTING)
 		return;
 
+	cutGrowing = state == LS_GROWING;		// it may have arrived this tick, resolve() has not attached it yet
+	state = LS_CUTTING;
+	if(deferred)
+		parent->getPlanet()->pendingLinks.push_back(this);
+	else
+		detach();
+}
+
+void Link::resolve() {
+	if(state == LS_NORMAL) {
+		if(!leech && target)
+			attach();
+	} else
+		detach();
+}
+
+void Link::detach() {
 	if(target) {
-		if(state == LS_GROWING) {	// check black list
+		if(cutGrowing) {	// check black list
 			float dist = points.empty() ? (points.back() - end).length() : (parent->getPos()-end).length();
 			dist += length;
-			parent->getPlanet()->checkBlackList(parent->getRace(), target, dist);
-			target->checkBlackList(parent->getRace(), parent->getPlanet(), dist);
+			parent->getPlanet()->checkBlackList(parent->getRace(), planetLink, dist);
+			target->checkBlackList(parent->getRace(), targetLink, dist);
 		}
 
 		target->onUnlinkTarget(this);
@@ -153,7 +284,6 @@ void Link::cut() {
 		leech->removeSeeder(this);
 		leech = 0;
 	}
-	state = LS_CUTTING;
 }
 
 void Link::buildDrawBuffer() {
@@ -175,22 +305,32 @@ void Link::buildDrawBuffer() {
 			n = vec2(-dir.y, dir.x) * linkWidth;
 
 			int idx = i*2;
-			verts[idx]   = TreeVert(p - n, -n, float(i));
-			verts[idx+1] = TreeVert(p + n,  n, float(i));
+			verts[idx]   = TreeVert(p - n, -n, levels[i]);
+			verts[idx+1] = TreeVert(p + n,  n, levels[i]);
 		}
 		int idx = (points.size()-1)*2;
-		verts[idx]   = TreeVert(points.back() - n, -n, float(points.size()-1));
-		verts[idx+1] = TreeVert(points.back() + n,  n, float(points.size()-1));
+		verts[idx]   = TreeVert(points.back() - n, -n, levels.back());
+		verts[idx+1] = TreeVert(points.back() + n,  n, levels.back());
 
 		if(setAllData) 
 			vertsVBO.setData(verts.size() * sizeof(TreeVert), GL_DYNAMIC_DRAW, &verts[0]);
 		else
 			vertsVBO.setSubData(startIndex * sizeof(TreeVert), (verts.size() - startIndex) * sizeof(TreeVert), &verts[startIndex]);
+		drawnTip = points.back();
 	}
 
 	lastBuildBufferPointSize = points.size();
 }
 
+void Link::updateDrawBufferTip(const vec2 &tip) {
+	int idx = (points.size()-1)*2;
+	vec2 n = verts[idx+1].n;
+	TreeVert v[2] = {	TreeVert(tip - n, -n, verts[idx].lev),
+						TreeVert(tip + n,  n, verts[idx+1].lev)	};
+	vertsVBO.setSubData(idx * sizeof(TreeVert), sizeof(v), v);
+	drawnTip = tip;
+}
+
 void Link::buildVBOIndex(VBOIndex &index) {
 	std::vector<unsigned short> idxs;
 	idxs.resize(30000);
@@ -209,6 +349,9 @@ void Link::draw(Render *render) {
 
 	vertsVBO.bind();
 	buildDrawBuffer();
+	vec2 tip = prevTip + (points.back() - prevTip) * render->getTickAlpha();
+	if(points.size() > 1 && tip != drawnTip)
+		updateDrawBufferTip(tip);
 	render->bindLinkVBOIndex();
 
 	glEnableVertexAttribArray(ATTRIB_POSITION);
@@ -25,17 +25,22 @@ class Planet;
 class Tree;
 class Render;
 
-class Link {
+class Link: public ArenaObject {
 friend class Tree;
 friend class Mind;
 	Planet	*target;
 	Tree	*parent, *leech;
 	vec2	dir, end, current;
+	vec2	prevTip, drawnTip;		// tip at the previous tick and in the VBO
 	rect	bounds;
-	float	dist, length;
-	int		drawIndex, lastRecalcBounds, lastBuildBufferPointSize, age;
-	std::vector<vec2> points;
-	std::vector<TreeVert> verts;
+	std::vector<rect, ArenaAllocator<rect> > prevBounds;	// bounds before each point was added
+	float	dist, length, wave;
+	int		drawIndex, lastBuildBufferPointSize, age;
+	std::vector<vec2, ArenaAllocator<vec2> > points;
+	std::vector<float, ArenaAllocator<float> > levels;	// growing steps up to each point, the shader animates by them
+	vec2	sleeveDir;				// the last segment may still be stretched in directions
+	float	sleeveMin, sleeveMax;	// from its start within these angles to sleeveDir
+	std::vector<TreeVert, ArenaAllocator<TreeVert> > verts;
 
 	enum LinkState {
 		LS_GROWING,
@@ -44,18 +49,30 @@ friend class Mind;
 		LS_DIED
 	};
 	LinkState state;	
+	bool	cutGrowing;			// cut before it arrived, detach() checks the black list
+	int		planetLink, targetLink;	// in WorldState::links from the parent's planet to target and back, or -1
+	void	findPlanetLinks();
 	void	setLeech(Tree *t);
-	void	recalcBounds();
+	void	attach();
+	void	detach();
+	void	addPoint(const vec2 &p);
 
 	VBOVertex	vertsVBO;	
 	void	buildDrawBuffer();
+	void	updateDrawBufferTip(const vec2 &tip);
 public:
 			Link(Tree *par, Planet *p);
+			Link(Tree *par, SnapshotReader &s, const SnapshotTable<Tree> &trees);
 			~Link();
 	Tree*	getParent()				{	return parent;	}
+	vec2	getTip()				{	return current;	}
+	bool	isGrowing()				{	return state == LS_GROWING;	}
+	void	save(SnapshotWriter &s, const SnapshotTable<Tree> &trees);
 	void	stepUp(float v);
 	void	stepDown(float v);
-	void	cut();
+	void	cut(bool deferred = false);
+	void	resolve();
+	void	saveState()				{	prevTip = points.empty() ? current : points.back();	}
 	void	draw(Render *render);
 	void	drawBounds(Render *render);
 
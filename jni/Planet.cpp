@@ -18,16 +18,29 @@
 #include "opengl.h"
 #include "rand.h"
 #include "World.h"
+#include "WorldState.h"
 #include "Link.h"
 #include "utils.h"
 
-PlanetObject::PlanetObject(const vec2 &ps, float r): pos(ps), radius(r) {
-	seed = (rand() % 1000 + 3) / 100.73f;
-	planetObjects.push_back(this);
+PlanetObject::PlanetObject(WorldState &ws, const vec2 &ps, float r, Random &rnd): pos(ps), radius(r) {
+	seed = (rnd.next() % 1000 + 3) / 100.73f;
+	ws.planetObjects.push_back(this);
 }
 
-BlackHole::BlackHole(const vec2 &p, float r): PlanetObject(p, r) {
-	blackHoles.push_back(this);
+void PlanetObject::save(SnapshotWriter &s) {
+	s.put(pos);
+	s.put(radius);
+	s.put(seed);
+}
+
+void PlanetObject::load(SnapshotReader &s) {
+	s.get(pos);
+	s.get(radius);
+	s.get(seed);
+}
+
+BlackHole::BlackHole(WorldState &ws, const vec2 &p, float r, Random &rnd): PlanetObject(ws, p, r, rnd) {
+	ws.blackHoles.push_back(this);
 }
 
 BlackHole::~BlackHole() {
@@ -40,10 +53,10 @@ void BlackHole::draw(Render *render) {
 	render->drawCircle(pos, radius);
 }
 
-Planet::Planet(const vec2 &ps, float r, float rh): PlanetObject(ps, r), rich(rh) {
+Planet::Planet(WorldState &w, const vec2 &ps, float r, float rh, Random &rnd): PlanetObject(w, ps, r, rnd), ws(w), rich(rh), random(rnd.next()), linksBegin(0), linksEnd(0) {
 	maxLength = radius*radius*100.0f;
-	index = planets.size();
-	planets.push_back(this);
+	index = ws.planets.size();
+	ws.planets.push_back(this);
 	for(int i=0; i<4; ++i)
 		sounds[i].attach( Sound::instance().getBuffer((SoundType)i) );
 }
@@ -51,28 +64,109 @@ Planet::Planet(const vec2 &ps, float r, float rh): PlanetObject(ps, r), rich(rh)
 Planet::~Planet() {
 	for(int i=0; i<3; ++i)
 		sounds[i].release();
-	blackList.clear();
+	linksBegin = linksEnd = 0;		// the black list goes with the world, other planets are not told
 	while(!trees.empty()) 
 		delete trees.back();
 }
 
+void Planet::save(SnapshotWriter &s) {
+	PlanetObject::save(s);
+	s.put(maxLength);
+	s.put(rich);
+	s.put(random);
+}
+
+void Planet::load(SnapshotReader &s) {
+	PlanetObject::load(s);
+	s.get(maxLength);
+	s.get(rich);
+	s.get(random);
+}
+
+// trees, black list and growing points, races and planets are stored as indices
+void Planet::saveState(SnapshotWriter &s) {
+	unsigned int count = 0;
+	for(size_t r=0; r<ws.genuses.size(); ++r)
+		for(int i = linksBegin; i < linksEnd; ++i)
+			if(ws.blackListed(r, i) >= 0)
+				count++;
+	s.put(count);
+	for(size_t r=0; r<ws.genuses.size(); ++r)
+		for(int i = linksBegin; i < linksEnd; ++i)
+			if(ws.blackListed(r, i) >= 0) {
+				s.put((int)r);
+				s.put(ws.links[i].planet->index);
+				s.put(ws.blackListed(r, i));
+			}
+	s.put((unsigned int)growingPoints.size());
+	for(std::vector<GrowingPoint>::iterator gp = growingPoints.begin(); gp != growingPoints.end(); ++gp) {
+		s.put(gp->race->getIndex());
+		s.put(gp->point);
+		s.put(gp->counter);
+	}
+	s.put((unsigned int)trees.size());
+	for(std::vector<Tree*>::iterator t = trees.begin(); t != trees.end(); ++t) {
+		s.put((*t)->getRace()->getIndex());
+		(*t)->save(s);
+	}
+}
+
+bool Planet::loadState(SnapshotReader &s, SnapshotTable<Tree> &allTrees) {
+	unsigned int count = s.get<unsigned int>();
+	for(unsigned int i=0; i<count && !s.failed(); ++i) {
+		unsigned int r = s.get<int>(), p = s.get<int>();
+		float distance = s.get<float>();
+		if(r >= ws.genuses.size() || p >= ws.planets.size())
+			return false;
+		int link = findLink(ws.planets[p]);
+		if(link >= 0)
+			ws.blackListed(r, link) = distance;
+	}
+	count = s.get<unsigned int>();
+	for(unsigned int i=0; i<count && !s.failed(); ++i) {
+		unsigned int r = s.get<int>();
+		GrowingPoint gp(0, s.get<vec2>());
+		s.get(gp.counter);
+		if(r >= ws.genuses.size())
+			return false;
+		gp.race = ws.genuses[r];
+		raceGrowingPoints.resize(std::max(raceGrowingPoints.size(), (size_t)r+1), -1);
+		raceGrowingPoints[r] = growingPoints.size();
+		growingPoints.push_back(gp);
+	}
+	count = s.get<unsigned int>();
+	for(unsigned int i=0; i<count && !s.failed(); ++i) {
+		unsigned int r = s.get<int>();
+		if(r >= ws.genuses.size())
+			return false;
+		Tree *t = Tree::load(ws.genuses[r], this, s);
+		add(t);
+		allTrees.add(t);
+	}
+	return !s.failed();
+}
+
 void Planet::add(Tree *t) {
 	trees.push_back(t);
+	setRaceTree(t->getRace(), t);
 }
 
-bool Planet::canSelect(Genus *r) {
-	for(std::vector<GrowingPoint>::iterator gp = growingPoints.begin(); gp!=growingPoints.end(); ++gp)
-		if(gp->race == r)
-			return true;
-	return false;
+void Planet::setRaceTree(Genus *r, Tree *t) {
+	if(r->getIndex() >= (int)raceTrees.size())
+		raceTrees.resize(r->getIndex()+1, 0);
+	raceTrees[r->getIndex()] = t;
 }
 
 vec2 Planet::getGrowingPoint(Genus *r, const vec2 &dir) {
-	for(std::vector<GrowingPoint>::iterator gp = growingPoints.begin(); gp!=growingPoints.end(); ++gp)
-		if(gp->race == r) {
-			gp->counter++;
-			return gp->point;
-		}
+	int idx = r->getIndex();
+	if(canSelect(idx)) {
+		GrowingPoint &gp = growingPoints[raceGrowingPoints[idx]];
+		gp.counter++;
+		return gp.point;
+	}
+	if(idx >= (int)raceGrowingPoints.size())
+		raceGrowingPoints.resize(idx+1, -1);
+	raceGrowingPoints[idx] = growingPoints.size();
 	growingPoints.push_back( GrowingPoint(r, getBestNewGrowingPoint(dir) ) );
 	return growingPoints.back().point;
 }
@@ -91,7 +185,7 @@ vec2 Planet::getBestNewGrowingPoint(const vec2 d) {
 	vec2 testPoint = result;
 	vec2 testDir = dir;
 	float maxDistance = 0;
-	int sig = rand() & 1;
+	int sig = random.next() & 1;
 
 	for(int i=0; i<10; ++i) {
 
@@ -124,18 +218,22 @@ vec2 Planet::getBestNewGrowingPoint(const vec2 d) {
 }
 
 void Planet::decreaseGrowingPoint(Genus *r) {
-	for(std::vector<GrowingPoint>::iterator gp = growingPoints.begin(); gp!=growingPoints.end(); ++gp)
-		if(gp->race == r) {
-			gp->counter--;
-			if(gp->counter<=0) {
-				*gp = growingPoints.back();
-				growingPoints.pop_back();
-			}
-			return;
-		}
+	if(!canSelect(r))
+		return;
+	int &idx = raceGrowingPoints[r->getIndex()];
+	GrowingPoint &gp = growingPoints[idx];
+	gp.counter--;
+	if(gp.counter<=0) {
+		gp = growingPoints.back();
+		raceGrowingPoints[gp.race->getIndex()] = idx;
+		growingPoints.pop_back();
+		idx = -1;
+	}
 }
 
 void Planet::onTreeDied(Tree *t) {
+	if(getTree(t->getRace()) == t)
+		setRaceTree(t->getRace(), 0);
 	clearBlackList(t->getRace());
 	decreaseGrowingPoint(t->getRace());
 	vector_fast_remove(trees, t);
@@ -165,49 +263,87 @@ void Planet::step() {
 	if(trees.empty())
 		return;
 
-	for(;;) {
-		float length = 0, sumWeakness = 0;
-		for(std::vector<Tree*>::iterator t = trees.begin(); t != trees.end(); ++t) {
-			float newLength = (*t)->getLength() + (*t)->getGrowing();
-			if(newLength>0) {
-				length += newLength;
-				sumWeakness += (*t)->getWeakness();
-			}
-		}
-
-		float overLength = length > maxLength ? (length - maxLength) : 0; 
-		if(overLength<=EPSILON)
-			break;
-		for(std::vector<Tree*>::iterator t = trees.begin(); t != trees.end(); ++t) {
-			float newLength = (*t)->getLength() + (*t)->getGrowing();
-			if(newLength>0) 
-				(*t)->addGrowing( -overLength * (*t)->getWeakness()/sumWeakness);
+	for(std::vector<Tree*>::iterator t = trees.begin(); t != trees.end(); ++t)
+		(*t)->gatherSeeding();
+
+	stepLengths.resize(trees.size());
+	stepWeakness.resize(trees.size());
+	stepTrees.resize(trees.size());
+	stepOrder.resize(trees.size());
+	int count = 0;
+	for(size_t i=0; i<trees.size(); ++i) {
+		float newLength = trees[i]->getLength() + trees[i]->getGrowing();
+		if(newLength>0) {
+			stepLengths[count] = newLength;
+			stepWeakness[count] = trees[i]->getWeakness();
+			stepTrees[count++] = i;
 		}
 	}
+	if(count && fitLengths(&stepLengths[0], &stepWeakness[0], &stepOrder[0], count, maxLength))
+		for(int i=0; i<count; ++i) {
+			Tree *t = trees[stepTrees[i]];
+			t->addGrowing(stepLengths[i] - t->getLength() - t->getGrowing());
+		}
 
-	for(std::vector<Tree*>::iterator t = trees.begin(); t != trees.end(); ) {
-//		float g = (*t)->getGrowing() - overLength * (*t)->getWeakness()/sumWeakness;
+	for(std::vector<Tree*>::iterator t = trees.begin(); t != trees.end(); ++t) {
 		(*t)->step((*t)->getGrowing());
-		if((*t)->getLength() < EPSILON && (*t)->canDelete() ) {
-			Tree *tt = *t;
-			t = trees.erase(t);
-			delete tt;
-			continue;
- 		} 
+		if((*t)->getLength() < EPSILON && (*t)->canDelete() ) 
+			dyingTrees.push_back(*t);
 		(*t)->resetGrowing();
-		++t;
 	}
 }
 
-Tree* Planet::getTree(Genus* r) {
-	for(std::vector<Tree*>::iterator t = trees.begin(); t != trees.end(); ++t) 
-		if((*t)->getRace() == r)
-			return *t;
-	return 0;
+struct FitRatioLess {
+	const float	*lengths, *weakness;
+	FitRatioLess(const float *l, const float *w): lengths(l), weakness(w)	{}
+	bool operator()(int a, int b) const		{	return lengths[a]*weakness[b] < lengths[b]*weakness[a];	}
+};
+
+// Cuts the lengths down to maxLength, each one loses in proportion to its weakness. The ones that
+// would go below zero are clamped and the rest is shared by the others, in the order they run out.
+// Used by step() and by the AI prediction, returns false when nothing was over.
+bool Planet::fitLengths(float *lengths, const float *weakness, int *order, int count, float maxLength) {
+	float sum = 0, sumWeakness = 0;
+	for(int i=0; i<count; ++i) {
+		sum += lengths[i];
+		sumWeakness += weakness[i];
+		order[i] = i;
+	}
+	if(sum - maxLength <= EPSILON)
+		return false;
+
+	std::sort(order, order + count, FitRatioLess(lengths, weakness));
+	float cut = (sum - maxLength) / sumWeakness;
+	int first = 0;
+	for(; first < count-1 && lengths[order[first]] <= cut * weakness[order[first]]; ++first) {
+		int i = order[first];
+		sum -= lengths[i];
+		sumWeakness -= weakness[i];
+		lengths[i] = 0;
+		cut = (sum - maxLength) / sumWeakness;
+	}
+	for(int j=first; j<count; ++j)
+		lengths[order[j]] -= cut * weakness[order[j]];
+	return true;
 }
 
-void Planet::addLink(Planet *p, float d) {
-	links.push_back(PlanetLink(p, d));
+// applies what step() did to the other planets, called for every planet in order after all steps
+void Planet::resolve() {
+	for(std::vector<Link*>::iterator l = pendingLinks.begin(); l != pendingLinks.end(); ++l)
+		(*l)->resolve();
+	pendingLinks.clear();
+
+	for(std::vector<Link*>::iterator l = deadLinks.begin(); l != deadLinks.end(); ++l)
+		delete *l;
+	deadLinks.clear();
+
+	for(std::vector<Tree*>::iterator t = dyingTrees.begin(); t != dyingTrees.end(); ++t) {
+		if((*t)->getLength() >= EPSILON || !(*t)->canDelete())		// a link of other planet has attached to it
+			continue;
+		trees.erase( std::find(trees.begin(), trees.end(), *t) );
+		delete *t;
+	}
+	dyingTrees.clear();
 }
 
 void Planet::draw(Render *render) {
@@ -233,58 +369,48 @@ void Planet::drawTreeLinks(Render *render) {
 		(*t)->drawLinks(render);
 }
 
-void Planet::checkBlackList(Genus *r, Planet *target, float distance) {
-	for(std::vector<PlanetLink>::iterator l = links.begin(); l != links.end(); ++l) {
-		if(l->planet == target) {
-			if(l->distance > distance) 
-				return;
-			checkBlackListInt(r, target, distance);
-		} 
+// the adjacency is sorted by planet index
+int Planet::findLink(Planet *target) {
+	int lo = linksBegin, hi = linksEnd;
+	while(lo < hi) {
+		int mid = (lo + hi) / 2;
+		if(ws.links[mid].planet->index < target->index)
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
+	return lo < linksEnd && ws.links[lo].planet == target ? lo : -1;
 }
 
-void Planet::checkBlackListInt(Genus *r, Planet *target, float distance) {
-	for(std::vector<BlackPlanetLink>::iterator l = blackList.begin(); l != blackList.end(); ++l) {
-		if(l->race == r && l->planet == target) { 
-			if(l->distance < distance)	
-				l->distance = distance;
-			return;
-		}
-	}
-	blackList.push_back(BlackPlanetLink(r, target, distance));
+// link is one of this planet's, links keep theirs so a cut does not search for them
+void Planet::checkBlackList(Genus *r, int link, float distance) {
+	if(link < 0 || ws.links[link].distance > distance)
+		return;
+	float &d = ws.blackListed(r->getIndex(), link);
+	if(d < distance)	
+		d = distance;
 }
 
 void Planet::clearBlackList(Genus *r) {
-	for(std::vector<BlackPlanetLink>::iterator l = blackList.begin(); l != blackList.end();) 
-		if(l->race == r) {
-			BlackPlanetLink &ll = *l;
-			l->planet->clearBlackList(r, this);
-			l = blackList.erase(l);
-		} else 
-			++l;
+	for(int i = linksBegin; i < linksEnd; ++i) {
+		float &d = ws.blackListed(r->getIndex(), i);
+		if(d >= 0) {
+			d = -1.0f;
+			if(ws.links[i].back >= 0)
+				ws.blackListed(r->getIndex(), ws.links[i].back) = -1.0f;
+		}
+	}
 }
 
 void Planet::clearBlackList(Genus *r, Planet *target) {
-	for(std::vector<BlackPlanetLink>::iterator l = blackList.begin(); l != blackList.end(); ++l) 
-		if(l->race == r && l->planet == target) {
-			*l = blackList.back();
-			blackList.pop_back();
-			return;
-		} 
+	int link = findLink(target);
+	if(link >= 0)
+		ws.blackListed(r->getIndex(), link) = -1.0f;
 }
 
 float Planet::blackListDistance(Genus *r, Planet *target) {
-	for(size_t i = 0; i < blackList.size(); ++i) {
-		BlackPlanetLink bl = blackList[i];
-		if(bl.race == r && bl.planet == target)  
-			return bl.distance;
-	}
-
-//	for(std::vector<PlanetLink>::iterator l = links.begin(); l != links.end(); ++l) 
-//		if(l->planet == target) 
-//			return l->distance;
-
-	return -1;
+	int link = findLink(target);
+	return link >= 0 ? ws.blackListed(r->getIndex(), link) : -1.0f;
 }
 
 float Planet::touchDistance(const vec2 &p, float r)	{
@@ -308,7 +434,3 @@ void Planet::invalidate() {
 		(*t)->invalidate();
 }
 
-std::vector<PlanetObject*> planetObjects;
-std::vector<Planet*> planets;
-std::vector<BlackHole*> blackHoles;
-
@@ -20,27 +20,32 @@
 #include "HalfTree.h"
 #include "Sound.h"
 #include "Genus.h"
+#include "SpatialGrid.h"
+#include "rand.h"
 #include <vector>
 
 class Tree;
 class Link;
 class Render;
+class WorldState;
 
 class PlanetObject {
 protected:
 	vec2	pos;
 	float	radius, seed;
-			PlanetObject(const vec2 &p, float r);
+			PlanetObject(WorldState &ws, const vec2 &p, float r, Random &rnd);
 public:
 	virtual ~PlanetObject()	{}
 	vec2	getPos()						{	return pos;					}
 	float	getRadius()						{	return radius;				}
 	virtual void	draw(Render *render) = 0;
+	virtual void	save(SnapshotWriter &s);
+	virtual void	load(SnapshotReader &s);
 };
 
 class BlackHole: public PlanetObject {
 public:
-			BlackHole(const vec2 &p, float r);
+			BlackHole(WorldState &ws, const vec2 &p, float r, Random &rnd);
 	virtual ~BlackHole();
 	virtual void	draw(Render *render);
 };
@@ -50,23 +55,24 @@ friend class Link;
 friend class Tree;
 friend class World;
 friend class Mind;
+friend class WorldState;
+	WorldState	&ws;
 	int		index;
 	float	maxLength, rich;
 	bool	visible;
+	Random	random;
 	std::vector<Tree*> trees;
+	std::vector<Link*> pendingLinks;	// reached or cut this tick, other planets are updated in resolve()
+	std::vector<Tree*> dyingTrees;
+	std::vector<Link*> deadLinks;		// deleted in resolve(), the arena is shared by all planets
 	SoundSource	sounds[4];
 
 	struct PlanetLink {
 		Planet	*planet;
 		float	distance;
+		int		back;					// the link of planet back to this one or -1
 		PlanetLink()														{}
-		PlanetLink(Planet *p, float d): planet(p), distance(d)				{}
-	};
-
-	struct BlackPlanetLink: PlanetLink {
-		Genus	*race;
-		BlackPlanetLink()															{}
-		BlackPlanetLink(Genus *r, Planet *p, float d): PlanetLink(p, d), race(r)		{}
+		PlanetLink(Planet *p, float d): planet(p), distance(d), back(-1)	{}
 	};
 
 	struct GrowingPoint {
@@ -77,37 +83,48 @@ friend class Mind;
 		GrowingPoint(Genus *r, const vec2 &p): race(r), point(p), counter(1)	{}
 	};
 
-	std::vector<PlanetLink>			links;
-	std::vector<BlackPlanetLink>	blackList;
+	int		linksBegin, linksEnd;		// this planet's part of WorldState::links and of its black list
 	std::vector<GrowingPoint>		growingPoints;
+	std::vector<Tree*>	raceTrees;				// by genus index, the tree of the race or 0
+	std::vector<int>	raceGrowingPoints;		// by genus index, the race's entry in growingPoints or -1
+	std::vector<float>	stepLengths, stepWeakness;	// step() scratch, kept to not allocate every tick
+	std::vector<int>	stepTrees, stepOrder;
 
 	virtual bool	deform(vec2 &p);
 			void	add(Tree *t);
-			void	addLink(Planet *p, float d);
+			int		findLink(Planet *target);
+			void	setRaceTree(Genus *r, Tree *t);
 
 			vec2	getBestNewGrowingPoint(const vec2 dir);
 			void	decreaseGrowingPoint(Genus *r);
 			void	onTreeDied(Tree *t);
 			void	onUnlinkTarget(Link *l);
-
-			void	checkBlackListInt(Genus *r, Planet *target, float distance);
 public:
-			Planet(const vec2 &p, float r, float rh);
+			Planet(WorldState &ws, const vec2 &p, float r, float rh, Random &rnd);
 	virtual	~Planet();
+	virtual void	save(SnapshotWriter &s);
+	virtual void	load(SnapshotReader &s);
+			void	saveState(SnapshotWriter &s);
+			bool	loadState(SnapshotReader &s, SnapshotTable<Tree> &allTrees);
 	vec2	getGrowingPoint(Genus *r, const vec2 &dir);
-	bool 	canSelect(Genus *r);
-	void	checkBlackList(Genus *r, Planet *target, float cutDistance);
+	bool 	canSelect(Genus *r)				{	return canSelect(r->getIndex());	}
+	void	checkBlackList(Genus *r, int link, float cutDistance);
 	void	clearBlackList(Genus *r);
 	void	clearBlackList(Genus *r, Planet *target);
 	float	blackListDistance(Genus *r, Planet *target);
+	bool 	canSelect(int race)				{	return race < (int)raceGrowingPoints.size() && raceGrowingPoints[race] >= 0;	}
+	Tree*	getTree(int race)				{	return race < (int)raceTrees.size() ? raceTrees[race] : 0;	}
+	static	bool	fitLengths(float *lengths, const float *weakness, int *order, int count, float maxLength);
 
 	bool	inside(const vec2 &p)				{	return (p-pos).length2() <= radius*radius;	}
 	float	touchDistance(const vec2 &p, float r);
 	void	growUp();
 	void	step();
+	void	resolve();
 	void	drawTrees(Render *render);
 	void	drawTreeLinks(Render *render);
-	Tree*	getTree(Genus* r);
+	Tree*	getTree(Genus* r)				{	return getTree(r->getIndex());		}
+	WorldState&	getWorldState()		{	return ws;	}
 
 	void	drawBounds(Render *render);
 	float	getMaxLength()					{	return maxLength;	}
@@ -117,8 +134,4 @@ public:
 			void	invalidate();
 };
 
-extern std::vector<PlanetObject*>	planetObjects;
-extern std::vector<Planet*>	planets;
-extern std::vector<BlackHole*>	blackHoles;
-
 #endif
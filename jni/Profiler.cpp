@@ -0,0 +1,140 @@
+/*  
+	Copyright (c) 2012, Alexey Saenko
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/ 
+
+#include "Profiler.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+static const char *phaseNames[PP_COUNT] = {
+	"frame", "grow up", "step", "resolve", "ai", "ai search", "finish game", "tutorial",
+	"render noise", "render world", "render post", "sound", "music", "load resource", "load level"
+};
+
+volatile bool Profiler::enabled = false;
+
+Profiler::Profiler(): head(0) {
+	memset(ring, 0, sizeof(ring));
+	memset(totals, 0, sizeof(totals));
+}
+
+static Profiler *profiler = 0;
+Profiler& Profiler::instance() {
+	if(!profiler)
+		profiler = new Profiler();
+	return *profiler;
+}
+
+void Profiler::destroy() {
+	enabled = false;
+	if(profiler) {
+		delete profiler;
+		profiler = 0;
+	}
+}
+
+// the instance is made here, so the other threads find it once they see the flag
+void Profiler::setEnabled(bool e) {
+	if(e)
+		instance();
+	__sync_synchronize();
+	enabled = e;
+}
+
+const char* Profiler::phaseName(int phase) {
+	return phase >= 0 && phase < PP_COUNT ? phaseNames[phase] : "?";
+}
+
+void Profiler::add(ProfilePhase phase, unsigned int usec) {
+	unsigned int idx = __sync_fetch_and_add(&head, 1);
+	Sample &s = ring[idx & (ringSize-1)];
+	s.seq = 0;
+	__sync_synchronize();
+	s.phase = phase;
+	s.usec = usec;
+	__sync_synchronize();
+	s.seq = idx + 1;
+
+	Total &t = totals[phase];
+	__sync_fetch_and_add(&t.usec, (unsigned long long)usec);
+	__sync_fetch_and_add(&t.count, 1);
+	unsigned int m = t.max;
+	while(usec > m && !__sync_bool_compare_and_swap(&t.max, m, usec))
+		m = t.max;
+}
+
+void Profiler::reset() {
+	memset(totals, 0, sizeof(totals));
+}
+
+void Profiler::collect(Stats stats[PP_COUNT]) {
+	std::vector<unsigned int> samples[PP_COUNT];
+	unsigned int end = head;
+	unsigned int begin = end > ringSize ? end - ringSize : 0;
+	for(unsigned int idx = begin; idx != end; ++idx) {
+		const Sample &s = ring[idx & (ringSize-1)];
+		if(s.seq != idx + 1)
+			continue;						// not written yet or overwritten already
+		unsigned int phase = s.phase, usec = s.usec;
+		__sync_synchronize();
+		if(s.seq != idx + 1 || phase >= PP_COUNT)
+			continue;
+		samples[phase].push_back(usec);
+	}
+
+	for(int p=0; p<PP_COUNT; ++p) {
+		Stats &st = stats[p];
+		std::vector<unsigned int> &v = samples[p];
+		st.count = totals[p].count;
+		st.total = totals[p].usec;
+		st.samples = v.size();
+		st.mean = st.p99 = st.max = 0;
+		if(v.empty())
+			continue;
+		std::sort(v.begin(), v.end());
+		unsigned long long sum = 0;
+		for(size_t i=0; i<v.size(); ++i)
+			sum += v[i];
+		st.mean = float(sum) / v.size();
+		st.p99 = v[std::min(v.size() - 1, v.size() * 99 / 100)];
+		st.max = totals[p].max;
+	}
+}
+
+bool Profiler::dump(const char *filename) {
+	FILE *f = fopen(filename, "w");
+	if(!f)
+		return false;
+	Stats stats[PP_COUNT];
+	collect(stats);
+	fprintf(f, "%-14s %10s %12s %10s %10s %10s %10s\n", "phase", "count", "total ms", "mean us", "in ring", "ring p99", "max us");
+	for(int p=0; p<PP_COUNT; ++p) {
+		const Stats &st = stats[p];
+		if(st.count)
+			fprintf(f, "%-14s %10d %12.2f %10.1f %10d %10.1f %10.0f\n", phaseNames[p], st.count, st.total * 0.001f,
+					st.total / st.count, st.samples, st.p99, st.max);
+	}
+
+	fprintf(f, "\nlast samples, usec\n");
+	unsigned int end = head;
+	for(unsigned int idx = end > ringSize ? end - ringSize : 0; idx != end; ++idx) {
+		const Sample &s = ring[idx & (ringSize-1)];
+		if(s.seq == idx + 1 && s.phase < PP_COUNT)
+			fprintf(f, "%s,%u\n", phaseNames[s.phase], s.usec);
+	}
+	fclose(f);
+	return true;
+}
@@ -0,0 +1,93 @@
+/*  
+	Copyright (c) 2012, Alexey Saenko
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/ 
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "platform.h"
+
+enum ProfilePhase {
+	PP_FRAME,
+	PP_GROW_UP,
+	PP_STEP,
+	PP_RESOLVE,
+	PP_AI,
+	PP_AI_SEARCH,				// on the AI thread
+	PP_FINISH_GAME,
+	PP_TUTORIAL,
+	PP_RENDER_NOISE,
+	PP_RENDER_WORLD,
+	PP_RENDER_POST,				// blur and final passes, the CPU side only as GL is asynchronous
+	PP_SOUND,
+	PP_MUSIC,					// on the music thread
+	PP_LOAD_RESOURCE,			// files, images and sounds
+	PP_LOAD_LEVEL,
+	PP_COUNT
+};
+
+// Durations of the phases in microseconds. Any thread adds its samples to a ring without locks,
+// a reader takes the slots which were not overwritten meanwhile.
+class Profiler {
+	enum {
+		ringShift = 12,
+		ringSize = 1 << ringShift
+	};
+	struct Sample {
+		volatile unsigned int	seq;		// index + 1 of the sample written last, 0 while being written
+		unsigned int			phase, usec;
+	};
+	struct Total {
+		unsigned long long		usec;
+		unsigned int			count, max;
+	};
+
+	Sample	ring[ringSize];
+	volatile unsigned int	head;
+	Total	totals[PP_COUNT];
+	static	volatile bool	enabled;
+
+			Profiler();
+public:
+	struct Stats {
+		int		count, samples;				// since reset and in the ring
+		float	total, mean, p99, max;		// usec, mean and p99 over the ring, total and max since reset
+	};
+
+	static	Profiler&	instance();
+	static	void	destroy();
+	static	bool	isEnabled()						{	return enabled;	}
+	static	void	setEnabled(bool e);
+	static	const char*	phaseName(int phase);
+
+	void	add(ProfilePhase phase, unsigned int usec);
+	void	reset();
+	void	collect(Stats stats[PP_COUNT]);
+	bool	dump(const char *filename);
+};
+
+class ProfileTimer {
+	ProfilePhase		phase;
+	unsigned long long	start;
+public:
+	ProfileTimer(ProfilePhase p): phase(p), start(Profiler::isEnabled() ? platform::getMicros() : 0)		{}
+	~ProfileTimer()								{	stop();		}
+	void	stop() {						// before the end of the scope
+		if(start && Profiler::isEnabled())
+			Profiler::instance().add(phase, (unsigned int)(platform::getMicros() - start));
+		start = 0;
+	}
+};
+
+#endif
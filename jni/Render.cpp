@@ -25,19 +25,29 @@
 #include "Shader.h"
 #include "Texture.h"
 #include "utils.h"
+#include "Profiler.h"
+#include "platform.h"
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
 
 static std::vector<RenderResource*>	resources;
+static pthread_mutex_t	resourcesMutex = PTHREAD_MUTEX_INITIALIZER;		// links of several worlds come and go on their threads
 
 RenderResource::RenderResource() {
+	pthread_mutex_lock(&resourcesMutex);
 	resources.push_back(this);
+	pthread_mutex_unlock(&resourcesMutex);
 }
 
 RenderResource::~RenderResource() {
+	pthread_mutex_lock(&resourcesMutex);
 	vector_fast_remove(resources, this);
+	pthread_mutex_unlock(&resourcesMutex);
 	release();
 }
 
-Render::Render(): scale(0.25f), transform(1.0f), curShader(0), animate(0), deform(0), noiseStride(3)
+Render::Render(): scale(0.25f), transform(1.0f), curShader(0), animate(0), deform(0), tickAlpha(1.0f), noiseStride(3), profilerTicks(0)
 {}
 
 Render::~Render() {
@@ -59,8 +69,10 @@ void Render::destroy() {
 }
 
 void Render::release() {
+	pthread_mutex_lock(&resourcesMutex);
 	for(std::vector<RenderResource*>::iterator r = resources.begin(); r != resources.end(); ++r)
 		(*r)->release();
+	pthread_mutex_unlock(&resourcesMutex);
 }
 
 void Render::reshape(int w, int h) {
@@ -225,6 +237,7 @@ void Render::drawBegin(const vec2 &pos) {
 //	pass 0, render noise
 	noiseStride++;
 	if(noiseStride>=2) {
+		ProfileTimer pt(PP_RENDER_NOISE);
 		noiseStride = 0;
 		glViewport( 0, 0, fboNoise.width, fboNoise.height );
 		fboNoise.bind();
@@ -264,8 +277,11 @@ void Render::draw(World &world, FBO *renderTarget) {
 	mat4 viewMat = mat4::get_ortho(-aspect, aspect, -1, 1);
 	transform = viewMat * mat4::get_scale(scale, scale, scale) * mat4::get_translate(-pos.x, -pos.y, 0);
 	drawBegin(pos);
+	ProfileTimer pt(PP_RENDER_WORLD);
 
 	bounds=rect(vec2(-aspect, -1) /scale + pos, vec2(aspect, 1) / scale + pos);
+	std::vector<Planet*> &planets = world.getState().planets;
+	std::vector<BlackHole*> &blackHoles = world.getState().blackHoles;
 	if(!planets.empty()) {
 		setShader(&planetShaderProgram);
 		planetShaderProgram.uniform(SU_TRANSFORM, transform);
@@ -332,7 +348,20 @@ void Render::draw(World &world, FBO *renderTarget) {
 		titleFont.draw(-w*titleFontSize*0.5f, 1-titleFontSize, titleFontSize, world.getLevelTitle());
 		glDisable(GL_BLEND);
 	}
+	if(world.isSkipping() || world.getTimeScale() > 1) {
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+
+		beginFont(viewMat);
+		float speedFontSize = 0.1f;
+		std::string speed = world.isSkipping() ? std::string(">>") : "x" + to_string(world.getTimeScale());
+		setColor(color4(0.75f, 0.5f, 0.1f, 1));
+		float w = titleFont.width(speed.c_str());
+		titleFont.draw(aspect - (w + 0.5f)*speedFontSize, 1-speedFontSize*1.5f, speedFontSize, speed.c_str());
+		glDisable(GL_BLEND);
+	}
 	world.drawFlashText();
+	pt.stop();
 	drawEnd(renderTarget);
 }
 
@@ -346,6 +375,7 @@ void Render::beginBooble(const mat4 &transform) {
 }
 
 void Render::drawEnd(FBO *renderTarget) {
+	ProfileTimer pt(PP_RENDER_POST);
 //	glBlendFunc(GL_ONE, GL_ONE);
 
 	fbo.unbind();
@@ -453,6 +483,7 @@ void Render::drawChapteSShotBegin(const char *text, const color4 &tc) {
 }
 
 void Render::drawChapteSShotEnd(const color4 &c) {
+	ProfileTimer pt(PP_RENDER_POST);
 	fbo.unbind();
 	glDisable(GL_BLEND);
 
@@ -674,4 +705,39 @@ void Render::fade(float v) {
 	glDisable(GL_BLEND);
 }
 
+static const unsigned int profilerRefresh = 500;		// msec
+
+void Render::drawProfiler() {
+	unsigned int t = platform::getTicks();
+	if(t - profilerTicks >= profilerRefresh || profilerText.empty()) {
+		profilerTicks = t;
+		Profiler::Stats stats[PP_COUNT];
+		Profiler::instance().collect(stats);
+		profilerText.clear();
+		profilerText.push_back("ms");
+		profilerText.push_back("mean");
+		profilerText.push_back("p99");
+		for(int p=0; p<PP_COUNT; ++p) {
+			if(!stats[p].samples)
+				continue;
+			char buf[32];
+			profilerText.push_back(Profiler::phaseName(p));
+			snprintf(buf, sizeof(buf), "%.2f", stats[p].mean * 0.001f);
+			profilerText.push_back(buf);
+			snprintf(buf, sizeof(buf), "%.2f", stats[p].p99 * 0.001f);
+			profilerText.push_back(buf);
+		}
+	}
 
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	beginFont(mat4::get_ortho(-aspect, aspect, -1, 1));
+	setColor(color4(1, 1, 0.5f, 0.9f));
+	float size = 0.06f, x = -aspect + size, y = 1 - size*1.5f;
+	for(size_t i=0; i+2<profilerText.size(); i+=3, y-=size) {
+		simpleFont.draw(x, y, size, profilerText[i].c_str());
+		simpleFont.draw(x + size*8, y, size, profilerText[i+1].c_str());
+		simpleFont.draw(x + size*12, y, size, profilerText[i+2].c_str());
+	}
+	glDisable(GL_BLEND);
+}
@@ -24,6 +24,7 @@
 #include "Texture.h"
 #include "Font.h"
 #include <vector>
+#include <string>
 
 class World;
 class RenderResource;
@@ -55,9 +56,12 @@ class Render {
 	mat4			transform;
 	ShaderProgram	*curShader;
 	float			animate, deform;
+	float			tickAlpha;
 	Texture			planetTexture;
 	Font			titleFont, simpleFont;
 	int				noiseStride;
+	std::vector<std::string>	profilerText;		// name, mean and p99 of every phase
+	unsigned int	profilerTicks;
 
 	void	generatePlanetTexture(int size);
 	void	generateCircleVerts();
@@ -103,9 +107,12 @@ public:
 	void	drawCircle(const vec2& p, float r)								{		drawCircle(transform, p, r);	}
 
 	const	rect &getBounds()					{	return bounds;	}	
+	void	setTickAlpha(float a)				{	tickAlpha = a;	}
+	float	getTickAlpha()						{	return tickAlpha;	}		// position of the frame between the last two simulation ticks
 	void	drawRect(const rect &r, const color4& c);
 
 	void	fade(float v);
+	void	drawProfiler();
 
 	void	bindPlantVBOIndex()					{	plantVBOIndex.bind();		}
 	void	bindLinkVBOIndex()					{	linkVBOIndex.bind();		}
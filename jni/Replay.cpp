@@ -0,0 +1,155 @@
+/*  
+	Copyright (c) 2012, Alexey Saenko
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/ 
+
+#include "Replay.h"
+#include <stdio.h>
+
+static const unsigned int replayMagic = 0x314C5052;		// "RPL1"
+
+static void writeVarint(std::vector<unsigned char> &out, unsigned int v) {
+	while(v >= 0x80) {
+		out.push_back((unsigned char)(v | 0x80));
+		v >>= 7;
+	}
+	out.push_back((unsigned char)v);
+}
+
+static void writeU32(std::vector<unsigned char> &out, unsigned int v) {
+	for(int i=0; i<4; ++i)
+		out.push_back((unsigned char)(v >> (i*8)));
+}
+
+class ReplayReader {
+	const std::vector<unsigned char> &data;
+	size_t	pos;
+public:
+	bool	error;
+	ReplayReader(const std::vector<unsigned char> &d): data(d), pos(0), error(false) {}
+	unsigned char byte() {
+		if(pos >= data.size()) {
+			error = true;
+			return 0;
+		}
+		return data[pos++];
+	}
+	unsigned int varint() {
+		unsigned int v = 0;
+		for(int shift = 0; shift < 35; shift += 7) {
+			unsigned char b = byte();
+			v |= (unsigned int)(b & 0x7F) << shift;
+			if(!(b & 0x80))
+				return v;
+		}
+		error = true;
+		return 0;
+	}
+	unsigned int u32() {
+		unsigned int v = 0;
+		for(int i=0; i<4; ++i)
+			v |= (unsigned int)byte() << (i*8);
+		return v;
+	}
+};
+
+void Replay::clear() {
+	level.clear();
+	seed = ticks = 0;
+	playerRace = -1;
+	commands.clear();
+	checkpoints.clear();
+	overflow = false;
+}
+
+// ticks are stored as deltas, so a long game costs a few bytes per command
+bool Replay::save(const char *path) const {
+	if(overflow)
+		return false;
+	std::vector<unsigned char> out;
+	writeU32(out, replayMagic);
+	writeU32(out, seed);
+	writeVarint(out, ticks);
+	writeVarint(out, playerRace + 1);
+	writeVarint(out, level.size());
+	out.insert(out.end(), level.begin(), level.end());
+
+	writeVarint(out, commands.size());
+	unsigned int tick = 0;
+	for(std::vector<Command>::const_iterator c = commands.begin(); c != commands.end(); ++c) {
+		writeVarint(out, c->tick - tick);
+		tick = c->tick;
+		out.push_back((unsigned char)(c->type | (c->race << 2)));
+		writeVarint(out, c->from);
+		writeVarint(out, c->to);
+	}
+
+	writeVarint(out, checkpoints.size());
+	tick = 0;
+	for(std::vector<Checkpoint>::const_iterator c = checkpoints.begin(); c != checkpoints.end(); ++c) {
+		writeVarint(out, c->tick - tick);
+		tick = c->tick;
+		writeU32(out, c->hash);
+	}
+
+	FILE *f = fopen(path, "wb");
+	if(!f)
+		return false;
+	bool ok = fwrite(&out[0], 1, out.size(), f) == out.size();
+	return fclose(f) == 0 && ok;
+}
+
+bool Replay::load(const char *path) {
+	clear();
+	FILE *f = fopen(path, "rb");
+	if(!f)
+		return false;
+	std::vector<unsigned char> data;
+	unsigned char buf[4096];
+	size_t n;
+	while((n = fread(buf, 1, sizeof(buf), f)) > 0)
+		data.insert(data.end(), buf, buf + n);
+	fclose(f);
+
+	ReplayReader r(data);
+	if(r.u32() != replayMagic)
+		return false;
+	seed = r.u32();
+	ticks = r.varint();
+	playerRace = (int)r.varint() - 1;
+	unsigned int len = r.varint();
+	for(unsigned int i=0; i<len && !r.error; ++i)
+		level += (char)r.byte();
+
+	unsigned int count = r.varint();
+	unsigned int tick = 0;
+	for(unsigned int i=0; i<count && !r.error; ++i) {
+		Command c;
+		tick += r.varint();
+		c.tick = tick;
+		unsigned char b = r.byte();
+		c.type = b & 3;
+		c.race = b >> 2;
+		c.from = r.varint();
+		c.to = r.varint();
+		commands.push_back(c);
+	}
+
+	count = r.varint();
+	tick = 0;
+	for(unsigned int i=0; i<count && !r.error; ++i) {
+		tick += r.varint();
+		checkpoints.push_back(Checkpoint(tick, r.u32()));
+	}
+	return !r.error;
+}
@@ -0,0 +1,67 @@
+/*  
+	Copyright (c) 2012, Alexey Saenko
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/ 
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <string>
+#include <vector>
+
+// Commands of one game tagged by tick, enough to re-run the level exactly.
+// Player commands of tick N are applied before the planets step, AI commands after them.
+class Replay {
+public:
+	enum CommandType {
+		RC_ATTACK,			// player: link, or unlink when the target links back
+		RC_SURRENDER,
+		RC_LINK,			// AI
+		RC_UNLINK
+	};
+
+	struct Command {
+		enum {
+			maxRace = 0xFF,
+			maxPlanet = 0xFFFF
+		};
+		unsigned int	tick;
+		unsigned char	type, race;
+		unsigned short	from, to;
+		Command()	{}
+		Command(unsigned int t, CommandType ct, int r, int f, int tt): tick(t), type(ct), race(r), from(f), to(tt)	{}
+		bool	fromAI() const			{	return type >= RC_LINK;	}
+		static bool	fits(int r, int f, int tt)	{	return r <= maxRace && f <= maxPlanet && tt <= maxPlanet;	}
+	};
+
+	struct Checkpoint {
+		unsigned int	tick, hash;
+		Checkpoint()	{}
+		Checkpoint(unsigned int t, unsigned int h): tick(t), hash(h)	{}
+	};
+
+	std::string		level;
+	unsigned int	seed, ticks;
+	int				playerRace;				// -1 if nobody plays
+	std::vector<Command>	commands;
+	std::vector<Checkpoint>	checkpoints;
+	bool			overflow;				// a command did not fit, the game can't be re-run from it
+
+	Replay(): seed(0), ticks(0), playerRace(-1), overflow(false)		{}
+
+	void	clear();
+	bool	save(const char *path) const;
+	bool	load(const char *path);
+};
+
+#endif
@@ -14,16 +14,24 @@
 */ 
 
 #include "ResourceManager.h"
+#include "Profiler.h"
 #include <algorithm>
-#include <zip.h>
 #include <png.h>
+#if USE_ZIP
+#include <zip.h>
+#endif
 
-#ifdef _DEBUG
+#if USE_FILES
 
+#ifdef WIN32
 #include  <io.h>
+#define access _access
+#else
+#include  <unistd.h>
+#endif
 
 static bool fileExists(const char *filename) {
-   return _access( filename, 0 ) != -1;
+   return access( filename, 0 ) != -1;
 }
 
 static void *loadFile(const char *filename, int &fsize) {
@@ -74,6 +82,7 @@ ResourceManager* ResourceManager::instance() {
 }
 
 ResourceManager::ResourceManager(const char *apkFilename): archive(0) {
+#if USE_ZIP
 	archive = zip_open(apkFilename, 0, NULL);
 
 	if(archive) {
@@ -88,58 +97,79 @@ ResourceManager::ResourceManager(const char *apkFilename): archive(0) {
 	//		LOGI("File %i : %s\n", i, name);
 		}
 	}
+#else
+	root = std::string(apkFilename) + "/";		// assets root directory
+#endif
 }
 
 ResourceManager::~ResourceManager() {
+#if USE_ZIP
 	if(archive)
 		zip_close(archive);
+#endif
 }
 
 ResourceManager::file ResourceManager::open(const char *filename) {
-#ifdef _DEBUG
-	if(fileExists(filename)) {
-		FILE *fp = fopen(filename, "rb");
+#if USE_FILES
+	std::string path = root + filename;
+	if(fileExists(path.c_str())) {
+		FILE *fp = fopen(path.c_str(), "rb");
 		return file(filename, fp);
 	}
 #endif
+#if USE_ZIP
 	zip_file *zfile = zip_fopen(archive, filename, 0);
 	return file(filename, zfile);
+#else
+	return file();
+#endif
 }
 
 unsigned int ResourceManager::file::read(void *buf, unsigned int size) {
-#ifdef _DEBUG
+#if USE_FILES
 	if(ffile) 
 		return fread(buf, 1, size, ffile);
 #endif
+#if USE_ZIP
 	if(!zfile)
 		return 0;
 	ssize_t rs = zip_fread(zfile, buf, size);
 	return rs>0 ? rs : 0;
+#else
+	return 0;
+#endif
 }
 
 bool ResourceManager::file::rewind() {
-#ifdef _DEBUG
+#if USE_FILES
 	if(ffile) {
 		::rewind(ffile);
 		return true;
 	}
 #endif
+#if USE_ZIP
 	if(!zfile)
 		return false;
 	zip_fclose(zfile);
 	zfile = zip_fopen(ResourceManager::instance()->archive, filename.c_str(), 0);
 	return true;
+#else
+	return false;
+#endif
 }
 
 void ResourceManager::file::close() {
-#ifdef _DEBUG
+#if USE_FILES
 	if(ffile) {
 		fclose(ffile);
+		ffile = 0;
 		return;
 	}
 #endif
+#if USE_ZIP
 	if(zfile)
 		zip_fclose(zfile);
+#endif
 }
 
 static ResourceManager::file pngfile;
@@ -149,10 +179,15 @@ static void png_zip_read(png_structp png_ptr, png_bytep data, png_size_t length)
 }
 
 void *ResourceManager::loadFile(const char *filename, int &fsize) {
-#ifdef _DEBUG
-	if(fileExists(filename)) 
-		return ::loadFile(filename, fsize);
+	ProfileTimer pt(PP_LOAD_RESOURCE);
+#if USE_FILES
+	std::string path = root + filename;
+	if(fileExists(path.c_str())) 
+		return ::loadFile(path.c_str(), fsize);
 #endif
+#if !USE_ZIP
+	return 0;
+#else
 
 	int fidx = zip_name_locate(archive, filename, 0);
 	if( fidx == -1)
@@ -187,10 +222,12 @@ void *ResourceManager::loadFile(const char *filename, int &fsize) {
 
 	fsize = st.size;
 	return buffer;
+#endif
 }
 
 
 unsigned char *ResourceManager::readPNG(const char *filename, int &width, int &height) {
+	ProfileTimer pt(PP_LOAD_RESOURCE);
 	file file = open(filename);
 	if(!file)
 	    return 0;
@@ -16,7 +16,19 @@
 #ifndef RESOURCEMANAGER_H_
 #define RESOURCEMANAGER_H_
 
-#ifdef _DEBUG
+#if defined(__linux__) && !defined(ANDROID)
+	#define USE_ZIP		0		// Linux host reads assets straight from the directory
+	#define USE_FILES	1
+#else
+	#define USE_ZIP		1
+	#ifdef _DEBUG
+		#define USE_FILES	1
+	#else
+		#define USE_FILES	0
+	#endif
+#endif
+
+#if USE_FILES
 #include "stdio.h"
 #endif
 
@@ -27,12 +39,13 @@ struct zip;
 
 class ResourceManager {
 	zip* 	archive;
+	std::string	root;
 public:
 	class	file {
 		std::string		filename;
 		zip_file		*zfile;
 	public:
-#ifdef _DEBUG
+#if USE_FILES
 		FILE			*ffile;
 						file(): zfile(0), ffile(0)													{}
 						file(const char* fname, zip_file *f): filename(fname), zfile(f), ffile(0)	{}
@@ -0,0 +1,46 @@
+/*  
+	Copyright (c) 2012, Alexey Saenko
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/ 
+
+#include "Snapshot.h"
+#include <stdio.h>
+
+bool SnapshotWriter::save(const char *path) {
+	FILE *f = fopen(path, "wb");
+	if(!f)
+		return false;
+	bool ok = data.empty() || fwrite(&data[0], 1, data.size(), f) == data.size();
+	return fclose(f) == 0 && ok;
+}
+
+// one read of the whole file, the size is known from the seek
+bool SnapshotReader::load(const char *path) {
+	buffer.clear();
+	reset(buffer);
+	FILE *f = fopen(path, "rb");
+	if(!f)
+		return false;
+	bool ok = fseek(f, 0, SEEK_END) == 0;
+	long size = ok ? ftell(f) : -1;
+	ok = size > 0 && fseek(f, 0, SEEK_SET) == 0;
+	if(ok) {
+		buffer.resize(size);
+		ok = fread(&buffer[0], 1, size, f) == (size_t)size;
+	}
+	fclose(f);
+	if(!ok)
+		buffer.clear();
+	reset(buffer);
+	return ok;
+}
@@ -0,0 +1,138 @@
+/*  
+	Copyright (c) 2012, Alexey Saenko
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/ 
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+// Memory image of the running game. Values are stored as they are laid out in memory,
+// so the header keeps the byte order and the size of every type stored so, and a build
+// that lays any of them out otherwise rejects the snapshot.
+
+class SnapshotWriter {
+	std::vector<unsigned char>	data;
+public:
+	void	clear()									{	data.clear();	}
+	void	reserve(size_t size)					{	data.reserve(size);	}
+	const std::vector<unsigned char>& getData()		{	return data;	}
+
+	void	write(const void *p, size_t size) {
+		if(!size)
+			return;
+		size_t at = data.size();
+		data.resize(at + size);
+		memcpy(&data[at], p, size);
+	}
+	template<class T>
+	void	put(const T &v)							{	write(&v, sizeof(T));	}
+	template<class V>
+	void	putVector(const V &v) {
+		put((unsigned int)v.size());
+		if(!v.empty())
+			write(&v[0], v.size() * sizeof(v[0]));
+	}
+	void	putString(const std::string &s) {
+		put((unsigned int)s.size());
+		write(s.data(), s.size());
+	}
+
+	bool	save(const char *path);
+};
+
+class SnapshotReader {
+	std::vector<unsigned char>	buffer;
+	const unsigned char	*pos, *end;
+	bool	error;
+public:
+			SnapshotReader(): pos(0), end(0), error(false)	{}
+			SnapshotReader(const std::vector<unsigned char> &d): error(false)	{	reset(d);	}
+	void	reset(const std::vector<unsigned char> &d) {
+		pos = d.empty() ? 0 : &d[0];
+		end = pos + d.size();
+		error = false;
+	}
+	bool	load(const char *path);
+	bool	failed()								{	return error;	}
+
+	bool	read(void *p, size_t size) {
+		if(error || size > size_t(end - pos)) {
+			error = true;
+			memset(p, 0, size);
+			return false;
+		}
+		memcpy(p, pos, size);
+		pos += size;
+		return true;
+	}
+	template<class T>
+	void	get(T &v)								{	read(&v, sizeof(T));	}
+	template<class T>
+	T		get()									{	T v; read(&v, sizeof(T)); return v;	}
+	template<class V>
+	void	getVector(V &v) {
+		unsigned int n = get<unsigned int>();
+		if(error || n > size_t(end - pos) / sizeof(v[0])) {
+			error = true;
+			v.clear();
+			return;
+		}
+		v.resize(n);
+		if(n)
+			read(&v[0], n * sizeof(v[0]));
+	}
+	std::string	getString() {
+		unsigned int n = get<unsigned int>();
+		if(error || n > size_t(end - pos)) {
+			error = true;
+			return std::string();
+		}
+		std::string s((const char*)pos, n);
+		pos += n;
+		return s;
+	}
+};
+
+// numbers the objects that refer to each other, -1 stands for none
+template<class T>
+class SnapshotTable {
+	std::vector<T*>	items;
+	std::vector<std::pair<T*, int> >	index;		// sorted by pointer, for writing
+public:
+	int		add(T *p) {
+		items.push_back(p);
+		return items.size() - 1;
+	}
+	void	buildIndex() {
+		index.resize(items.size());
+		for(size_t i=0; i<items.size(); ++i)
+			index[i] = std::make_pair(items[i], (int)i);
+		std::sort(index.begin(), index.end());
+	}
+	int		find(T *p) const {
+		if(!p)
+			return -1;
+		typename std::vector<std::pair<T*, int> >::const_iterator it = std::lower_bound(index.begin(), index.end(), std::make_pair(p, -1));
+		return it != index.end() && it->first == p ? it->second : -1;
+	}
+	T*		get(int id) const						{	return id >= 0 && id < (int)items.size() ? items[id] : 0;	}
+	size_t	size() const							{	return items.size();	}
+	T*		operator[](size_t i) const				{	return items[i];	}
+};
+
+#endif
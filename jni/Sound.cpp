@@ -15,6 +15,7 @@
 
 #include "Sound.h"
 #include "platform.h"
+#include "Profiler.h"
 #include <AL/alc.h>
 #include <string>
 
@@ -302,6 +303,7 @@ void MusicPlayer::play(const char *filename) {
 static const float volumeStep = 0.001f;	// 1 second
 
 void MusicPlayer::update(unsigned timeDelta) {
+	ProfileTimer pt(PP_MUSIC);
 	switch(state) {
 		case ST_PLAYING:
 			if(!sstream.update())
@@ -390,6 +392,7 @@ void SoundBuffer::release() {
 }
 
 bool SoundBuffer::load(const char *filename) {
+	ProfileTimer pt(PP_LOAD_RESOURCE);
 	if(!id)
 		alGenBuffers(1, &id);
 	if(!id)
@@ -448,6 +451,7 @@ void SoundSource::release() {
 void SoundSource::play() {
 	if(!id)
 		return;
+	ProfileTimer pt(PP_SOUND);
 	if(playing())
 		return;
 	alSourcePlay(id);
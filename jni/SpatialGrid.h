@@ -0,0 +1,142 @@
+/*  
+	Copyright (c) 2012, Alexey Saenko
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/ 
+
+#ifndef SPATIALGRID_H
+#define SPATIALGRID_H
+
+#include "math2d.h"
+#include <vector>
+#include <algorithm>
+
+// Uniform grid over static circles (T must have getPos() and getRadius()).
+// Every object is stored in all cells its reach (radius times the grid's reach factor) overlaps,
+// so a large object only widens the queries near it.
+template<class T>
+class SpatialGrid {
+	struct Item {
+		T		*object;
+		int		c0, r0;				// the first cell of the object's reach
+	};
+	vec2	origin;
+	float	cellSize, invCellSize, reach;
+	int		cols, rows;
+	std::vector<int>	cellStart;		// objects of cell c are items[cellStart[c] .. cellStart[c+1])
+	std::vector<Item>	items;
+
+	int		col(float x) const			{	return std::min(std::max(int((x - origin.x) * invCellSize), 0), cols-1);	}
+	int		row(float y) const			{	return std::min(std::max(int((y - origin.y) * invCellSize), 0), rows-1);	}
+
+public:
+	// Iterates the objects whose reach may touch the square p +- range, each once: an object
+	// stored in several of the cells is returned in the first of them both squares share.
+	class Query {
+		const SpatialGrid &grid;
+		int		c0, c1, r0, r1, c, r, i, end;
+	public:
+		Query(const SpatialGrid &g, const vec2 &p, float range): grid(g), i(0), end(0) {
+			if(grid.items.empty()) {
+				c0 = c1 = r0 = r1 = c = r = 0;
+				return;
+			}
+			c0 = c = grid.col(p.x - range);
+			c1 = grid.col(p.x + range);
+			r0 = r = grid.row(p.y - range);
+			r1 = grid.row(p.y + range);
+			i = grid.cellStart[r*grid.cols + c];
+			end = grid.cellStart[r*grid.cols + c + 1];
+		}
+		T*	next() {
+			for(;;) {
+				while(i == end) {
+					if(++c > c1) {
+						c = c0;
+						if(++r > r1)
+							return 0;
+					}
+					i = grid.cellStart[r*grid.cols + c];
+					end = grid.cellStart[r*grid.cols + c + 1];
+				}
+				const Item &item = grid.items[i++];
+				if(c == std::max(c0, item.c0) && r == std::max(r0, item.r0))
+					return item.object;
+			}
+		}
+	};
+
+	SpatialGrid(): cellSize(1), invCellSize(1), reach(1), cols(0), rows(0)	{}
+
+	void	clear() {
+		items.clear();
+		cellStart.clear();
+		cols = rows = 0;
+	}
+
+	// objects reach range times their radius, queries find them from there
+	template<class S>
+	void	build(const std::vector<S*> &objects, float range = 1.0f) {
+		clear();
+		reach = range;
+		if(objects.empty())
+			return;
+
+		rect bounds;
+		float radiusSum = 0;
+		for(typename std::vector<S*>::const_iterator o = objects.begin(); o != objects.end(); ++o) {
+			bounds.add((*o)->getPos());
+			radiusSum += (*o)->getRadius();
+		}
+		vec2 size = bounds.rt - bounds.lb;
+
+		// cells hold about one object and are about as wide as a typical reach
+		float typical = 2.0f * reach * radiusSum / objects.size();
+		cellSize = std::max(std::max(typical, sqrtf(size.x * size.y / objects.size())), 1e-3f);
+		int maxCells = objects.size() * 4 + 16;
+		while((int(size.x / cellSize) + 1) * (int(size.y / cellSize) + 1) > maxCells)
+			cellSize *= 2.0f;
+		invCellSize = 1.0f / cellSize;
+		origin = bounds.lb;
+		cols = int(size.x * invCellSize) + 1;
+		rows = int(size.y * invCellSize) + 1;
+
+		std::vector<int> first(objects.size() * 4);		// the cell rectangle of every reach
+		cellStart.assign(cols*rows + 1, 0);
+		for(size_t i = 0; i < objects.size(); ++i) {
+			vec2 p = objects[i]->getPos();
+			float d = reach * objects[i]->getRadius();
+			int *b = &first[i*4];
+			b[0] = col(p.x - d);
+			b[1] = row(p.y - d);
+			b[2] = col(p.x + d);
+			b[3] = row(p.y + d);
+			for(int r = b[1]; r <= b[3]; ++r)
+				for(int c = b[0]; c <= b[2]; ++c)
+					cellStart[r*cols + c + 1]++;
+		}
+		for(int c = 0; c < cols*rows; ++c)
+			cellStart[c+1] += cellStart[c];
+
+		items.resize(cellStart.back());
+		std::vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+		for(size_t i = 0; i < objects.size(); ++i) {
+			const int *b = &first[i*4];
+			Item item = { objects[i], b[0], b[1] };
+			for(int r = b[1]; r <= b[3]; ++r)
+				for(int c = b[0]; c <= b[2]; ++c)
+					items[fill[r*cols + c]++] = item;
+		}
+	}
+};
+
+#endif
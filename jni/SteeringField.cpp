@@ -0,0 +1,92 @@
+/*  
+	Copyright (c) 2012, Alexey Saenko
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/ 
+
+#include "SteeringField.h"
+#include "Planet.h"
+#include <algorithm>
+
+void SteeringField::clear() {
+	blocks.clear();
+	cells.clear();
+	cols = rows = 0;
+}
+
+inline vec2 SteeringField::node(int x, int y) const {
+	if(x < 0 || y < 0)
+		return vec2(0.0f);
+	int bx = x >> blockShift, by = y >> blockShift;
+	if(bx >= cols || by >= rows)
+		return vec2(0.0f);
+	int b = blocks[by*cols + bx];
+	if(b < 0)
+		return vec2(0.0f);
+	return cells[b + ((y & (blockSize-1)) << blockShift) + (x & (blockSize-1))];
+}
+
+vec2& SteeringField::addNode(int x, int y) {
+	int &b = blocks[(y >> blockShift)*cols + (x >> blockShift)];
+	if(b < 0) {
+		b = cells.size();
+		cells.resize(cells.size() + blockCells, vec2(0.0f));
+	}
+	return cells[b + ((y & (blockSize-1)) << blockShift) + (x & (blockSize-1))];
+}
+
+void SteeringField::build(const std::vector<PlanetObject*> &objects, float size) {
+	clear();
+	if(objects.empty())
+		return;
+
+	rect bounds;
+	for(std::vector<PlanetObject*>::const_iterator o = objects.begin(); o != objects.end(); ++o) {
+		float range = steeringRange * (*o)->getRadius();
+		bounds.add((*o)->getPos() - vec2(range));
+		bounds.add((*o)->getPos() + vec2(range));
+	}
+	cellSize = size;
+	invCellSize = 1.0f / size;
+	origin = bounds.lb - vec2(size);		// a margin of one node keeps every sample inside
+	vec2 extent = bounds.rt - origin;
+	cols = (int(extent.x * invCellSize) + 2 + blockSize-1) >> blockShift;
+	rows = (int(extent.y * invCellSize) + 2 + blockSize-1) >> blockShift;
+	blocks.assign(cols*rows, -1);
+
+	for(std::vector<PlanetObject*>::const_iterator o = objects.begin(); o != objects.end(); ++o) {
+		vec2 center = (*o)->getPos();
+		float radius = (*o)->getRadius();
+		float range = steeringRange * radius;
+		int x0 = int((center.x - range - origin.x) * invCellSize), x1 = int((center.x + range - origin.x) * invCellSize) + 1;
+		int y0 = int((center.y - range - origin.y) * invCellSize), y1 = int((center.y + range - origin.y) * invCellSize) + 1;
+		for(int y = y0; y <= y1; ++y)
+			for(int x = x0; x <= x1; ++x) {
+				vec2 delta;
+				float f = steeringForce(center, radius, origin + vec2(x, y) * size, delta);
+				if(f > 0 && f < 1.0f)		// a node right at the centre has no direction
+					addNode(x, y) += delta * (f * steeringObstacle);
+			}
+	}
+}
+
+vec2 SteeringField::sample(const vec2 &p) const {
+	if(blocks.empty())
+		return vec2(0.0f);
+	float fx = (p.x - origin.x) * invCellSize, fy = (p.y - origin.y) * invCellSize;
+	int x = (int)floorf(fx), y = (int)floorf(fy);
+	fx -= x;
+	fy -= y;
+	vec2 a = node(x, y) + (node(x+1, y) - node(x, y)) * fx;
+	vec2 b = node(x, y+1) + (node(x+1, y+1) - node(x, y+1)) * fx;
+	return a + (b - a) * fy;
+}
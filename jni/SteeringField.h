@@ -0,0 +1,64 @@
+/*  
+	Copyright (c) 2012, Alexey Saenko
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/ 
+
+#ifndef STEERINGFIELD_H
+#define STEERINGFIELD_H
+
+#include "math2d.h"
+#include <vector>
+
+class PlanetObject;
+
+static const float steeringRange = 2.0f;			// objects push growing links within this many radii
+static const float steeringObstacle = 1.25f;		// how hard the objects other than the link's target push
+static const float defaultSteeringCell = 0.1f;		// see roots_bench steering
+
+// How an object pushes a growing link at p: the direction in delta and a strength from 1 at its centre
+// to 0 at the edge of its range, in growing steps.
+inline float steeringForce(const vec2 &center, float radius, const vec2 &p, vec2 &delta) {
+	delta = p - center;
+	float d = delta.normalize();
+	float range = steeringRange * radius;
+	return d > range ? 0.0f : (range - d) / range;
+}
+
+// The push of all objects as obstacles, summed on a grid once per level and sampled bilinearly.
+// Only blocks of cells some object reaches are stored, the rest of the level is empty.
+// Levels opt in with a "steering" cell size: between close objects the summed push may send a link
+// round the other side, roots_bench steering counts such links per level.
+class SteeringField {
+	enum {
+		blockShift = 3,
+		blockSize = 1 << blockShift,
+		blockCells = blockSize * blockSize
+	};
+	vec2	origin;
+	float	cellSize, invCellSize;
+	int		cols, rows;					// in blocks
+	std::vector<int>	blocks;			// first cell of the block or -1
+	std::vector<vec2>	cells;
+
+	vec2	node(int x, int y) const;
+	vec2&	addNode(int x, int y);
+public:
+			SteeringField(): cellSize(1), invCellSize(1), cols(0), rows(0)	{}
+	void	build(const std::vector<PlanetObject*> &objects, float cellSize);
+	void	clear();
+	bool	empty() const				{	return blocks.empty();	}
+	vec2	sample(const vec2 &p) const;
+	size_t	getMemory() const			{	return blocks.size() * sizeof(int) + cells.size() * sizeof(vec2);	}
+};
+
+#endif
@@ -0,0 +1,177 @@
+/*  
+	Copyright (c) 2012, Alexey Saenko
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/ 
+
+#include "ThreadPool.h"
+#include "platform.h"
+#include <algorithm>
+
+static const int maxThreads = 8;
+
+static inline long long packSlice(int begin, int end) {
+	return ((long long)end << 32) | (unsigned int)begin;
+}
+
+static inline long long loadSlice(volatile long long *s) {
+	return __sync_fetch_and_add(s, 0);		// a plain 64 bit read may tear on 32 bit targets
+}
+
+static inline int sliceBegin(long long s)	{	return (int)(s & 0xFFFFFFFF);	}
+static inline int sliceEnd(long long s)		{	return (int)(s >> 32);			}
+
+ThreadPool::ThreadPool(int count): slices(0), task(0), arg(0), generation(0), active(0), finish(false) {
+	pthread_mutex_init(&mutex, 0);
+	pthread_cond_init(&startCond, 0);
+	pthread_cond_init(&doneCond, 0);
+	start(count);
+}
+
+ThreadPool::~ThreadPool() {
+	stop();
+	pthread_mutex_destroy(&mutex);
+	pthread_cond_destroy(&startCond);
+	pthread_cond_destroy(&doneCond);
+}
+
+void ThreadPool::start(int count) {
+	if(count <= 0)
+		count = std::min(platform::getCPUCount(), maxThreads);
+	count = std::max(count, 1);
+
+	slices = new long long[count];
+	for(int i=0; i<count; ++i)
+		slices[i] = 0;
+
+	finish = false;
+	generation = 0;			// new workers start having seen none, or they would run the last task again
+	threads.resize(count - 1);
+	workers.resize(count - 1);
+	for(int i=0; i<count-1; ++i) {
+		workers[i].pool = this;
+		workers[i].slot = i + 1;
+		pthread_create(&threads[i], 0, threadFunc, &workers[i]);
+	}
+}
+
+void ThreadPool::stop() {
+	pthread_mutex_lock(&mutex);
+	finish = true;
+	pthread_cond_broadcast(&startCond);
+	pthread_mutex_unlock(&mutex);
+
+	for(size_t i=0; i<threads.size(); ++i)
+		pthread_join(threads[i], 0);
+	threads.clear();
+	workers.clear();
+	delete[] slices;
+	slices = 0;
+}
+
+void ThreadPool::resize(int count) {
+	stop();
+	start(count);
+}
+
+bool ThreadPool::pop(int slot, int &idx) {
+	for(;;) {
+		long long s = loadSlice(&slices[slot]);
+		int b = sliceBegin(s), e = sliceEnd(s);
+		if(b >= e)
+			return false;
+		if(__sync_bool_compare_and_swap(&slices[slot], s, packSlice(b + 1, e))) {
+			idx = b;
+			return true;
+		}
+	}
+}
+
+bool ThreadPool::steal(int slot) {
+	int count = getThreadCount();
+	for(int i=1; i<count; ++i) {
+		int victim = (slot + i) % count;
+		for(;;) {
+			long long s = loadSlice(&slices[victim]);
+			int b = sliceBegin(s), e = sliceEnd(s);
+			if(b >= e)
+				break;
+			int half = (e - b + 1) / 2;
+			if(__sync_bool_compare_and_swap(&slices[victim], s, packSlice(b, e - half))) {
+				__sync_lock_test_and_set(&slices[slot], packSlice(e - half, e));		// own slice is empty, nobody else writes it
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void ThreadPool::work(int slot) {
+	for(;;) {
+		int idx;
+		while(pop(slot, idx))
+			task(arg, idx);
+		if(!steal(slot))
+			return;
+	}
+}
+
+void* ThreadPool::threadFunc(void* a) {
+	Worker *w = (Worker*)a;
+	ThreadPool *pool = w->pool;
+	int seen = 0;
+	for(;;) {
+		pthread_mutex_lock(&pool->mutex);
+		while(!pool->finish && pool->generation == seen)
+			pthread_cond_wait(&pool->startCond, &pool->mutex);
+		if(pool->finish) {
+			pthread_mutex_unlock(&pool->mutex);
+			break;
+		}
+		seen = pool->generation;
+		pthread_mutex_unlock(&pool->mutex);
+
+		pool->work(w->slot);
+
+		pthread_mutex_lock(&pool->mutex);
+		if(--pool->active == 0)
+			pthread_cond_signal(&pool->doneCond);
+		pthread_mutex_unlock(&pool->mutex);
+	}
+	return 0;
+}
+
+void ThreadPool::run(Task t, void *a, int count, int minParallel) {
+	if(threads.empty() || count < std::max(minParallel, 2)) {
+		for(int i=0; i<count; ++i)
+			t(a, i);
+		return;
+	}
+
+	int n = getThreadCount();
+	pthread_mutex_lock(&mutex);
+	task = t;
+	arg = a;
+	for(int i=0; i<n; ++i)
+		slices[i] = packSlice(count * i / n, count * (i + 1) / n);
+	active = threads.size();
+	generation++;
+	pthread_cond_broadcast(&startCond);
+	pthread_mutex_unlock(&mutex);
+
+	work(0);
+
+	pthread_mutex_lock(&mutex);
+	while(active > 0)
+		pthread_cond_wait(&doneCond, &mutex);
+	pthread_mutex_unlock(&mutex);
+}
@@ -0,0 +1,59 @@
+/*  
+	Copyright (c) 2012, Alexey Saenko
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/ 
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <pthread.h>
+#include <vector>
+
+// Runs count independent tasks on the calling thread and a few workers.
+// Each thread starts with its own contiguous slice and steals half of a busy slice when done.
+class ThreadPool {
+public:
+	typedef void (*Task)(void *arg, int idx);
+
+private:
+	std::vector<pthread_t>	threads;
+	volatile long long		*slices;		// per thread [begin, end) packed as end << 32 | begin
+	pthread_mutex_t	mutex;
+	pthread_cond_t	startCond, doneCond;
+	Task	task;
+	void	*arg;
+	int		generation, active;
+	bool	finish;
+
+	struct Worker {
+		ThreadPool	*pool;
+		int			slot;
+	};
+	std::vector<Worker>	workers;
+
+	bool	pop(int slot, int &idx);
+	bool	steal(int slot);
+	void	work(int slot);
+	static void* threadFunc(void* arg);
+
+	void	start(int count);
+	void	stop();
+public:
+			ThreadPool(int count = 0);		// 0 - one thread per core
+			~ThreadPool();
+	void	resize(int count);
+	int		getThreadCount()				{	return threads.size() + 1;	}
+	void	run(Task task, void *arg, int count, int minParallel = 1);
+};
+
+#endif
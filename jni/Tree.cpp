@@ -30,16 +30,76 @@ float normalLinkGrowingStep = 0.015f;
 Tree::Tree(Genus *r, Planet *pl, const vec2 &p, const vec2 &d, float lenBallance,
 				float l_up,   float lengthFactor_up,  float lengthFactorDiv_up,    float angleFactor_up,   float angleFactorDiv_up,
 				float l_down, float lengthFactor_down, float lengthFactorDiv_down, float angleFactor_down, float angleFactorDiv_down, 
-				Deformer *def): 
-	genus(r), planet(pl), lengthBallance(lenBallance), accumulator(0), lastStep(0),
-	coma(p, d, l_up, lengthFactor_up, lengthFactorDiv_up, angleFactor_up, angleFactorDiv_up, 0),
-	root(p, -d, l_down, lengthFactor_down, lengthFactorDiv_down, angleFactor_down, angleFactorDiv_down, def)
+				unsigned int rndSeed, Deformer *def): 
+	genus(r), planet(pl), lengthBallance(lenBallance), accumulator(0), seedRate(0), lastStep(0), random(rndSeed),
+	coma(pl->getWorldState().arena, p, d, l_up, lengthFactor_up, lengthFactorDiv_up, angleFactor_up, angleFactorDiv_up, 0, random.next()),
+	root(pl->getWorldState().arena, p, -d, l_down, lengthFactor_down, lengthFactorDiv_down, angleFactor_down, angleFactorDiv_down, def, random.next())
 {
-	seed = rand() % 1000 + 1;
+	seed = random.next() % 1000 + 1;
 	growUp();
 	calcVars();
 }
 
+// the planet and the genus lists are filled by the caller in the saved order
+Tree::Tree(Genus *r, Planet *pl, SnapshotReader &s): coma(pl->getWorldState().arena, s, 0), root(pl->getWorldState().arena, s, pl), genus(r), planet(pl) {
+	s.get(lengthBallance);
+	s.get(length);
+	s.get(treeLength);
+	s.get(accumulator);
+	s.get(seedRate);
+	s.get(lastStep);
+	s.get(random);
+	s.get(seed);
+}
+
+Tree* Tree::load(Genus *r, Planet *pl, SnapshotReader &s) {
+	return new(pl->getWorldState().arena) Tree(r, pl, s);
+}
+
+void Tree::save(SnapshotWriter &s) {
+	coma.save(s);
+	root.save(s);
+	s.put(lengthBallance);
+	s.put(length);
+	s.put(treeLength);
+	s.put(accumulator);
+	s.put(seedRate);
+	s.put(lastStep);
+	s.put(random);
+	s.put(seed);
+}
+
+void Tree::saveLinks(SnapshotWriter &s, const SnapshotTable<Tree> &trees, SnapshotTable<Link> &allLinks) {
+	s.put((unsigned int)links.size());
+	for(std::vector<Link*>::iterator l = links.begin(); l!=links.end(); ++l) {
+		(*l)->save(s, trees);
+		allLinks.add(*l);
+	}
+}
+
+void Tree::loadLinks(SnapshotReader &s, const SnapshotTable<Tree> &trees, SnapshotTable<Link> &allLinks) {
+	unsigned int count = s.get<unsigned int>();
+	for(unsigned int i=0; i<count && !s.failed(); ++i) {
+		Link *l = new(planet->getWorldState().arena) Link(this, s, trees);
+		links.push_back(l);
+		allLinks.add(l);
+	}
+}
+
+// the order of seeders is the order of summing in gatherSeeding()
+void Tree::saveSeeders(SnapshotWriter &s, const SnapshotTable<Link> &allLinks) {
+	s.put((unsigned int)seeders.size());
+	for(std::vector<Link*>::iterator l = seeders.begin(); l!=seeders.end(); ++l)
+		s.put(allLinks.find(*l));
+}
+
+void Tree::loadSeeders(SnapshotReader &s, const SnapshotTable<Link> &allLinks) {
+	unsigned int count = s.get<unsigned int>();
+	for(unsigned int i=0; i<count && !s.failed(); ++i)
+		if(Link *l = allLinks.get(s.get<int>()))
+			seeders.push_back(l);
+}
+
 Tree::~Tree() {
 	planet->onTreeDied(this);
 	genus->remove(this);
@@ -49,15 +109,15 @@ Tree::~Tree() {
 	}
 }
 
-Tree* Tree::build(Genus *r, Planet *p, float size, const vec2& a_dir) {
+Tree* Tree::build(Genus *r, Planet *p, float size, const vec2& a_dir, unsigned int rndSeed) {
 	vec2 dir = a_dir;
 	dir.normalize();
 	vec2 pos = p->getGrowingPoint(r, dir);
 	dir = pos - p->pos;
 	dir.normalize();
-	Tree *t = new Tree(r, p, pos, dir, r->lengthBallance,
+	Tree *t = new(p->getWorldState().arena) Tree(r, p, pos, dir, r->lengthBallance,
 			r->length_up, r->lengthFactor_up,  r->lengthFactorDiv_up, r->angleFactor_up, r->angleFactorDiv_up,
-			r->length_down, r->lengthFactor_down, r->lengthFactorDiv_down, r->angleFactor_down, r->angleFactorDiv_down, p);
+			r->length_down, r->lengthFactor_down, r->lengthFactorDiv_down, r->angleFactor_down, r->angleFactorDiv_down, rndSeed, p);
 	p->add(t);
 	r->add(t);
 	t->growTo(size);
@@ -81,6 +141,10 @@ void Tree::stepDown(float v) {
 }
 
 void Tree::step(float v) {
+	coma.saveState();
+	root.saveState();
+	for(std::vector<Link*>::iterator l = links.begin(); l!=links.end(); ++l)
+		(*l)->saveState();
 	lastStep = v;
 	stepPriv(v);
 	calcVars();
@@ -93,6 +157,7 @@ void Tree::stepPriv(float v) {
 				(*l)->age++;
 				break;
 			case Link::LS_DIED:
+				planet->deadLinks.push_back(*l);
 				l = links.erase(l);
 				continue;
 			case Link::LS_CUTTING:
@@ -103,7 +168,7 @@ void Tree::stepPriv(float v) {
 						v += linkCuttingStep;
 					} else {
 						v += (*l)->length;
-						delete (*l);
+						planet->deadLinks.push_back(*l);
 						l = links.erase(l);
 						continue;
 					}
@@ -131,7 +196,7 @@ void Tree::stepPriv(float v) {
 		if(needForGroving > v + coma.getLength() + root.getLength()) {
 			for(std::vector<Link*>::iterator l = links.begin(); l!=links.end(); ++l)
 				if((*l)->state == Link::LS_GROWING)
-					(*l)->cut();
+					(*l)->cut(true);
 		} else {
 			for(std::vector<Link*>::iterator l = links.begin(); l!=links.end(); ++l) 
 				if((*l)->state == Link::LS_GROWING) {
@@ -147,7 +212,7 @@ void Tree::stepPriv(float v) {
 		if(linkGrowingCount>0)
 			for(std::vector<Link*>::iterator l = links.begin(); l!=links.end(); ++l) {
 				if((*l)->state == Link::LS_GROWING) {
-					(*l)->cut();
+					(*l)->cut(true);
 					cutCount++;
 				}
 
@@ -155,7 +220,7 @@ void Tree::stepPriv(float v) {
 		else if(linkNormalCount>0)
 			for(std::vector<Link*>::iterator l = links.begin(); l!=links.end(); ++l) {
 				if((*l)->state == Link::LS_NORMAL) {
-					(*l)->cut();
+					(*l)->cut(true);
 					cutCount++;
 				}
 			}
@@ -185,7 +250,7 @@ bool Tree::link(Planet* target) {
 		return false;
 	if(isLinked(target))
 		return false;
-	links.push_back( new Link(this, target) );
+	links.push_back( new(planet->getWorldState().arena) Link(this, target) );
 	planet->playFX(SND_NEW_ROOTLET);
 	return true;
 }
@@ -234,9 +299,16 @@ void Tree::calcVars() {
 		length += (*l)->length;
 }
 
+// stepping to the length keeps coma and root at lengthBallance, so both halves are grown to their share at once
 void Tree::growTo(float len) {
-	while(length<len) 
-		step( len-length+0.01f );
+	if(length >= len)
+		return;
+	float comaLength = len * lengthBallance / (1.0f + lengthBallance);
+	coma.growTo(comaLength);
+	root.growTo(len - comaLength);
+	coma.saveState();
+	root.saveState();
+	calcVars();
 }
 
 void Tree::growUp() {
@@ -247,21 +319,22 @@ void Tree::growUp() {
 			cnt++;
 	if(cnt > 0) {
 		if(isMonopoly()) {
-			seeding(growing / cnt);
+			seedRate = growing / cnt;
 		} else {
 			growing /= cnt + 1;
-			seeding(growing);
+			seedRate = growing;
 			accumulator += growing;
 		}
 	}  else {
+		seedRate = 0;
 		accumulator += growing;
 	}
 }
 
-void Tree::seeding(float v) {
-	for(std::vector<Link*>::iterator l = links.begin(); l!=links.end(); ++l) 
-		if((*l)->state == Link::LS_NORMAL)
-			(*l)->leech->accumulator += v;
+// seeders are exactly the normal links leeching this tree, their parents are not stepped yet
+void Tree::gatherSeeding() {
+	for(std::vector<Link*>::iterator l = seeders.begin(); l!=seeders.end(); ++l) 
+		accumulator += (*l)->parent->seedRate;
 } 
 
 void Tree::removeSeeder(Link *l) {
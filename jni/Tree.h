@@ -18,15 +18,17 @@
 
 #include "HalfTree.h"
 #include "Genus.h"
+#include "Arena.h"
 #include <vector>
 
 class Planet;
 class Link;
 class Render;
 
-class Tree {
+class Tree: public ArenaObject {
 friend class Mind;
-	float	lengthBallance, length, treeLength, accumulator, lastStep;
+	float	lengthBallance, length, treeLength, accumulator, seedRate, lastStep;
+	Random	random;
 	HalfTree	coma, root;
 	Genus	*genus;
 	Planet	*planet;
@@ -39,25 +41,33 @@ friend class Mind;
 	void	stepDown(float v);
 	void	stepPriv(float v);
 	bool	isMonopoly();
-	void	seeding(float v);
 	void	growTo(float len);
 
 			Tree(Genus *r, Planet *pl, const vec2 &p, const vec2 &d, float lenBallance,
 				float l_up,   float lengthFactor_up,  float lengthFactorDiv_up,    float angleFactor_up,   float angleFactorDiv_up,
 				float l_down, float lengthFactor_down, float lengthFactorDiv_down, float angleFactor_down, float angleFactorDiv_down, 
-				Deformer *def=0);
+				unsigned int rndSeed, Deformer *def=0);
+			Tree(Genus *r, Planet *pl, SnapshotReader &s);
 public:
 	virtual	~Tree();
 
-	static Tree* build(Genus *r, Planet *pl, float size, const vec2& dir);
+	static Tree* build(Genus *r, Planet *pl, float size, const vec2& dir, unsigned int rndSeed);
+	static Tree* load(Genus *r, Planet *pl, SnapshotReader &s);
+	void	save(SnapshotWriter &s);
+	void	saveLinks(SnapshotWriter &s, const SnapshotTable<Tree> &trees, SnapshotTable<Link> &allLinks);
+	void	loadLinks(SnapshotReader &s, const SnapshotTable<Tree> &trees, SnapshotTable<Link> &allLinks);
+	void	saveSeeders(SnapshotWriter &s, const SnapshotTable<Link> &allLinks);
+	void	loadSeeders(SnapshotReader &s, const SnapshotTable<Link> &allLinks);
 
 	int		getCount();
+	int		getLinksCount()		{	return links.size();	}
 	float	getLength()			{	return length;			}
 	float	getTreeLength()		{	return treeLength;		}
 	vec2	getPos()			{	return coma.getPos();	}
 	vec2	getDir()			{	return coma.getDir();	}
 	Genus*	getRace()			{	return genus;			}
 	Planet*	getPlanet()			{	return planet;			}
+	Random&	getRandom()			{	return random;			}
 	float	getWeakness()		{	return genus->weakness;	}
 	void	step(float v);
 
@@ -73,6 +83,7 @@ public:
 	bool	canDelete()			{	return seeders.empty();	}	
 
 	void	growUp();
+	void	gatherSeeding();
 	float	getGrowing()		{	return accumulator;		}
 	void	addGrowing(float v)	{	accumulator += v;		}
 	void	resetGrowing()		{	accumulator = 0;		}
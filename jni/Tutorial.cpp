@@ -38,6 +38,7 @@ struct FlashText {
 static std::vector<FlashText> flashText;
 
 Tutorial::Tutorial(World *w): state(ST_START), toState(ST_ZOOM), world(w), source(0), dest(0), timer(timeout) {
+	std::vector<Planet*> &planets = world->getState().planets;
 	if(planets.size() >= 2) {
 		source = planets[0];
 		dest = planets[1];
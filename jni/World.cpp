@@ -25,16 +25,23 @@
 #include "utils.h"
 #include "Tutorial.h"
 #include "Settings.h"
+#include "platform.h"
+#include "Profiler.h"
 
 #include <algorithm>
 #include <fstream>
 #include <sstream>
 
 #include <stdio.h>
+#include <string.h>
 
 const int MAX_LEVELS = 19;
 
 const float defaultScale = 0.5f, maxScale = 2.0f, minScale = 0.1f;
+const int minParallelPlanets = 16;			// smaller maps are not worth waking the workers
+const int maxTimeScale = 8;
+const unsigned int skipFrameTime = 12;		// msec of ticks per frame while skipping, Main updates the world once a frame then
+const int aiDepth = 3;						// the deepest the minds search, the time budget may stop them earlier
 
 class LevelParser: public JSONParser {
 	enum ObjectType {
@@ -93,7 +100,7 @@ public:
 			case OT_TREES:
 				race = 0;
 				size = 0;
-				dir = randVec2();
+				dir = world.getRandom().randVec2();
 				return true;
 			default:
 				idx = 0;
@@ -107,13 +114,13 @@ public:
 
 		switch(otype.back()) {
 			case OT_RACES:
-				new Genus(color, grow, 1.0f / strength, linkFactor, 4.0f,
+				new Genus(world.getState(), color, grow, 1.0f / strength, linkFactor, 4.0f,
 							0.2f, 0.85f, 0.3f, PI/6.0f, 0.3f,
 							0.02f, 1.5f, 0.2f, PI/6.0f, 0.3f);
 				return true;
 			case OT_PLANET:
 				{
-					Planet *p = new Planet(position, radius, rich);
+					Planet *p = new Planet(world.getState(), position, radius, rich, world.getRandom());
 					world.addPlanet(p);
 					if(!trees.empty()) {
 						float sizeSum = 0;
@@ -125,14 +132,14 @@ public:
 								it->size *= factor;
 						}
 						for(std::vector<TreeInfo>::iterator it = trees.begin(); it!=trees.end(); ++it) 
-							if(it->race < (int)genuses.size()) 
-								Tree::build(genuses[it->race], p, it->size*p->getMaxLength(), it->dir);
+							if(it->race < (int)world.getState().genuses.size()) 
+								Tree::build(world.getState().genuses[it->race], p, it->size*p->getMaxLength(), it->dir, world.getRandom().next());
 					}
 				}
 				return true;
 			case OT_BLACK_HOLE:
 				{
-					BlackHole *b = new BlackHole(position, radius);
+					new BlackHole(world.getState(), position, radius, world.getRandom());
 				}
 				return true;
 			case OT_TREES:
@@ -183,6 +190,10 @@ public:
 				scale = v; 
 				return true;
 			}
+			if(name == "steering") {		// the cell size of the steering field, 0 for none
+				world.getState().steeringCell = v;
+				return true;
+			}
 			return false;
 		}
 			
@@ -251,7 +262,7 @@ public:
 };
 
 World::World(): Chapter(CID_GAME), boundsMin(F_INFINITY, F_INFINITY), boundsMax(-F_INFINITY, -F_INFINITY), pos(0, 0), scale(defaultScale), touchEvent(TE_NONE), currentRace(0), sourcePlanet(0), 
-	render(Render::instance()), state(ST_GAMEPLAY), currentLevel(-1), tutorial(0)
+	seed(0), steeringCell(0), tick(0), timeScale(1), skipping(false), recording(0), playback(0), playbackPos(0), playbackCheckpoint(0), playbackMismatches(0), render(Render::instance()), state(ST_GAMEPLAY), currentLevel(-1), tutorial(0)
 {
 	touched[0] = touched[1] = false;
 
@@ -267,7 +278,7 @@ World::~World() {
 void World::reshape(int w, int h) {
 	Chapter::reshape(w, h);
 	render.reshape(w, h);
-	for(std::vector<Planet*>::iterator p = planets.begin(); p != planets.end(); ++p)
+	for(std::vector<Planet*>::iterator p = ws.planets.begin(); p != ws.planets.end(); ++p)
 		(*p)->invalidate();
 }
 
@@ -278,23 +289,163 @@ void World::addPlanet(Planet *p) {
 	boundsMax.y = std::max(boundsMax.y, p->getPos().y + p->getRadius());
 }
 
+static void growUpPlanet(void *ws, int idx) {
+	((WorldState*)ws)->planets[idx]->growUp();
+}
+
+static void stepPlanet(void *ws, int idx) {
+	((WorldState*)ws)->planets[idx]->step();
+}
+
+// several ticks in a row when the time is scaled, the trees are drawn once after them
 void World::update() {
 	if(state != ST_GAMEPLAY)
 		return;
 
-	checkFinishGame();
-
-	for(std::vector<Planet*>::iterator p = planets.begin(); p!=planets.end(); ++p) 
-		(*p)->growUp();
-	for(std::vector<Planet*>::iterator p = planets.begin(); p!=planets.end(); ++p) 
-		(*p)->step();
+	if(skipping) {
+		unsigned int start = platform::getTicks();
+		while(state == ST_GAMEPLAY && platform::getTicks() - start < skipFrameTime)
+			step();
+		if(state != ST_GAMEPLAY)
+			skipping = false;
+	} else
+		for(int i=0; i<timeScale && state == ST_GAMEPLAY; ++i)
+			step();
 
-	ai.update();
 	if(titleColor.a>0)
 		titleColor.a -= 0.005f;
 
-	if(tutorial)
+	if(tutorial) {
+		ProfileTimer pt(PP_TUTORIAL);
 		tutorial->update();
+	}
+}
+
+void World::step() {
+	if(playback)
+		playCommands(false);
+	{
+		ProfileTimer pt(PP_FINISH_GAME);
+		checkFinishGame();
+	}
+
+	// planets touch only their own trees here, changes to other planets wait for resolve()
+	{
+		ProfileTimer pt(PP_GROW_UP);
+		workers.run(growUpPlanet, &ws, ws.planets.size(), minParallelPlanets);
+	}
+	{
+		ProfileTimer pt(PP_STEP);
+		workers.run(stepPlanet, &ws, ws.planets.size(), minParallelPlanets);
+	}
+	{
+		ProfileTimer pt(PP_RESOLVE);
+		for(std::vector<Planet*>::iterator p = ws.planets.begin(); p!=ws.planets.end(); ++p) 
+			(*p)->resolve();
+	}
+
+	if(playback)
+		playCommands(true);
+	else {
+		ProfileTimer pt(PP_AI);
+		ai.update();
+	}
+
+	tick++;
+	checkpoint();
+}
+
+void World::setTimeScale(int s) {
+	timeScale = std::min(std::max(s, 1), maxTimeScale);
+	skipping = false;
+}
+
+void World::record(Replay::CommandType type, Genus *r, Planet *from, Planet *to) {
+	if(!recording)
+		return;
+	int f = from ? from->index : 0, t = to ? to->index : 0;
+	if(!Replay::Command::fits(r->getIndex(), f, t)) {
+		recording->overflow = true;			// a level this big can't be recorded
+		return;
+	}
+	recording->commands.push_back(Replay::Command(tick, type, r->getIndex(), f, t));
+}
+
+// replayed commands go through the same calls as the original ones
+void World::playCommands(bool fromAI) {
+	const std::vector<Replay::Command> &cmds = playback->commands;
+	for(; playbackPos < cmds.size(); ++playbackPos) {
+		const Replay::Command &c = cmds[playbackPos];
+		if(c.tick != tick || c.fromAI() != fromAI)
+			break;
+		if(c.race >= ws.genuses.size() || c.from >= ws.planets.size() || c.to >= ws.planets.size())
+			continue;
+		Genus *r = ws.genuses[c.race];
+		switch(c.type) {
+			case Replay::RC_ATTACK:
+				attack(r, ws.planets[c.from], ws.planets[c.to]);
+				break;
+			case Replay::RC_SURRENDER:
+				r->clear();
+				break;
+			case Replay::RC_LINK:
+				link(r, ws.planets[c.from], ws.planets[c.to]);
+				break;
+			case Replay::RC_UNLINK:
+				unlink(r, ws.planets[c.from], ws.planets[c.to]);
+				break;
+		}
+	}
+}
+
+static const unsigned int checkpointStride = 60;
+
+void World::checkpoint() {
+	if(recording) {
+		recording->ticks = tick;
+		if(tick % checkpointStride == 0)
+			recording->checkpoints.push_back(Replay::Checkpoint(tick, stateHash()));
+	}
+	if(playback) {
+		const std::vector<Replay::Checkpoint> &cps = playback->checkpoints;
+		if(playbackCheckpoint < cps.size() && cps[playbackCheckpoint].tick == tick) {
+			if(cps[playbackCheckpoint].hash != stateHash())
+				playbackMismatches++;
+			playbackCheckpoint++;
+		}
+	}
+}
+
+static inline unsigned int hashAdd(unsigned int h, unsigned int v) {
+	return (h ^ v) * 16777619u;
+}
+
+unsigned int World::stateHash() {
+	unsigned int h = 2166136261u;
+	for(std::vector<Planet*>::iterator p = ws.planets.begin(); p != ws.planets.end(); ++p) 
+		for(std::vector<Tree*>::iterator t = (*p)->trees.begin(); t != (*p)->trees.end(); ++t) {
+			float len = (*t)->getLength();
+			unsigned int bits;
+			memcpy(&bits, &len, sizeof(bits));
+			h = hashAdd(h, (*p)->index);
+			h = hashAdd(h, (*t)->getRace()->getIndex());
+			h = hashAdd(h, bits);
+			h = hashAdd(h, (*t)->getCount());
+			h = hashAdd(h, (*t)->getLinksCount());
+		}
+	return h;
+}
+
+bool World::playReplay(const Replay *r) {
+	setSeed(r->seed);
+	if(!loadLevel(r->level.c_str()))
+		return false;
+	if(r->playerRace >= 0)
+		setCurrentRace(r->playerRace);
+	playback = r;
+	playbackPos = playbackCheckpoint = 0;
+	playbackMismatches = 0;
+	return true;
 }
 
 vec2 World::pointToPos(int x, int y) {
@@ -368,21 +519,39 @@ Planet*	World::getPlanet(const vec2 &point) {
 	float cs = main->getCursorSize()*defaultScale/scale;		// half of cursor size
 	Planet *planet = 0;
 	float minDistance = F_INFINITY;
-	for(std::vector<Planet*>::iterator p = planets.begin(); p != planets.end(); ++p) {
-		float d = (*p)->touchDistance(point, cs);
+	SpatialGrid<Planet>::Query q(ws.planetsGrid, point, cs);
+	while(Planet *p = q.next()) {
+		float d = p->touchDistance(point, cs);
 		if(d == 0.0f)
-			return *p;
+			return p;
 		if(d < 0.0f)
 			continue;
 		if(d < minDistance) {
-			planet = *p;
+			planet = p;
 			minDistance = d;
 		}
 	}
 	return planet;
 }
 
+bool World::link(Genus *r, Planet *from, Planet *to) {
+	record(Replay::RC_LINK, r, from, to);
+	Tree *t = from->getTree(r);
+	if(!t)
+		return false;
+	return t->link(to);
+}
+
+bool World::unlink(Genus *r, Planet *from, Planet *to) {
+	record(Replay::RC_UNLINK, r, from, to);
+	Tree *t = from->getTree(r);
+	if(!t)
+		return false;
+	return t->unlink(to);
+}
+
 bool World::attack(Genus *r, Planet *from, Planet *to) {
+	record(Replay::RC_ATTACK, r, from, to);
 	Tree *t = to->getTree(r);
 	if(t) {
 		if(t->unlink(from))
@@ -399,17 +568,7 @@ void World::clear() {
 	ai.abort();
 	currentRace = 0;
 	touchEvent = TE_NONE;
-	while(!planetObjects.empty()) {
-		delete planetObjects.back();
-		planetObjects.pop_back();
-	}
-	blackHoles.clear();
-	planets.clear();
-
-	while(!genuses.empty()) {
-		delete genuses.back();
-		genuses.pop_back();
-	}
+	ws.clear();
 
 	boundsMin = vec2(F_INFINITY, F_INFINITY);
 	boundsMax = vec2(-F_INFINITY, -F_INFINITY);
@@ -420,6 +579,8 @@ void World::clear() {
 		tutorial = 0;
 	}
 	sourcePlanet = 0;
+	timeScale = 1;
+	skipping = false;
 }
 
 bool World::loadLevel(const char *filename) {
@@ -431,22 +592,203 @@ bool World::loadLevel(const char *filename) {
 	if(!data)
 		return false;
 
+	loadLevelData(filename, data);
+	delete data;
+	return true;
+}
+
+// the name seeds the level, generated levels pass their text here without a file
+bool World::loadLevelData(const char *filename, const char *data) {
+	ProfileTimer pt(PP_LOAD_LEVEL);
 	clear();
+	unsigned int levelSeed = seed;
+	for(const char *c = filename; *c; ++c)
+		levelSeed = levelSeed * 31 + *c;
+	random.seed(levelSeed);		// the same level replays identically for the same inputs
+	ws.steeringCell = steeringCell;
+	tick = 0;
+	playback = 0;
+	if(recording) {
+		recording->clear();
+		recording->level = filename;
+		recording->seed = seed;
+	}
 	LevelParser lp(*this);
-	if( lp.parse(data) ) {
+	bool ok = lp.parse(data);
+	if(ok) {
+		ws.buildGrids();
 		calcPlanetGraph();
 
-		ai.clear();
-		for(size_t i=1; i<genuses.size(); ++i)
-			ai.add(new Mind(i, 3));
+		createMinds();
 	}
-	delete data;
 
+	state = ST_GAMEPLAY;
+	return ok;
+}
 
+static const unsigned int snapshotMagic = 0x314E5352;		// "RSN1"
+static const unsigned int snapshotVersion = 5;
+
+// the byte order and the sizes of everything written as raw memory
+static void snapshotLayout(std::vector<unsigned int> &layout) {
+	enum Probe {	P_NONE	};			// the saved enums are sized as this one
+	layout.clear();
+	layout.push_back(0x01020304);
+	layout.push_back(sizeof(void*));
+	layout.push_back(sizeof(bool));
+	layout.push_back(sizeof(int));
+	layout.push_back(sizeof(float));
+	layout.push_back(sizeof(Probe));
+	layout.push_back(sizeof(vec2));
+	layout.push_back(sizeof(rect));
+	layout.push_back(sizeof(color4));
+	layout.push_back(sizeof(Random));
+	layout.push_back(HalfTree::getNodeSize());
+}
+
+// trees and links refer to each other by their number in the walk order:
+// planets, their trees, the links of every tree
+bool World::saveSnapshot(SnapshotWriter &s) {
+	if(ws.planets.empty() || (state != ST_GAMEPLAY && state != ST_PAUSE))
+		return false;
+	s.put(snapshotMagic);
+	s.put(snapshotVersion);
+	std::vector<unsigned int> layout;
+	snapshotLayout(layout);
+	s.putVector(layout);
+	s.put(seed);
+	s.put(tick);
+	s.put(random);
+	s.put(currentLevel);
+	s.put(currentRace ? currentRace->getIndex() : -1);
+	s.put(pos);
+	s.put(scale);
+	s.put(titleColor);
+	s.put(ws.steeringCell);
+
+	s.put((unsigned int)ws.genuses.size());
+	for(std::vector<Genus*>::iterator r = ws.genuses.begin(); r != ws.genuses.end(); ++r)
+		(*r)->save(s);
+
+	s.put((unsigned int)ws.planetObjects.size());
+	std::vector<Planet*>::iterator p = ws.planets.begin();
+	for(std::vector<PlanetObject*>::iterator o = ws.planetObjects.begin(); o != ws.planetObjects.end(); ++o) {
+		bool isPlanet = p != ws.planets.end() && *o == *p;		// both lists are in the creation order
+		if(isPlanet)
+			++p;
+		s.put(isPlanet);
+		(*o)->save(s);
+	}
+
+	SnapshotTable<Tree> trees;
+	SnapshotTable<Link> links;
+	for(p = ws.planets.begin(); p != ws.planets.end(); ++p) 
+		for(std::vector<Tree*>::iterator t = (*p)->trees.begin(); t != (*p)->trees.end(); ++t)
+			trees.add(*t);
+	trees.buildIndex();
+
+	for(p = ws.planets.begin(); p != ws.planets.end(); ++p) 
+		(*p)->saveState(s);
+	for(size_t i=0; i<trees.size(); ++i)
+		trees[i]->saveLinks(s, trees, links);
+	links.buildIndex();
+	for(size_t i=0; i<trees.size(); ++i)
+		trees[i]->saveSeeders(s, links);
+	for(std::vector<Genus*>::iterator r = ws.genuses.begin(); r != ws.genuses.end(); ++r)
+		(*r)->saveTrees(s, trees);
+	ai.save(s);
+	return true;
+}
+
+bool World::loadSnapshot(SnapshotReader &s) {
+	if(s.get<unsigned int>() != snapshotMagic || s.get<unsigned int>() != snapshotVersion)
+		return false;
+	std::vector<unsigned int> layout, saved;
+	snapshotLayout(layout);
+	s.getVector(saved);
+	if(saved != layout)			// written by a build that lays the data out otherwise
+		return false;
+	clear();			// the tutorial is not restored, its level goes on without hints
+	playback = 0;
+	Random levelRandom;
+	int level, race;
+	vec2 p;
+	float sc;
+	s.get(seed);
+	s.get(tick);
+	s.get(levelRandom);
+	s.get(level);
+	s.get(race);
+	s.get(p);
+	s.get(sc);
+	s.get(titleColor);
+	s.get(ws.steeringCell);
+
+	unsigned int count = s.get<unsigned int>();
+	for(unsigned int i=0; i<count && !s.failed(); ++i)
+		Genus::load(ws, s);
+
+	count = s.get<unsigned int>();
+	for(unsigned int i=0; i<count && !s.failed(); ++i) 
+		if(s.get<bool>()) {
+			Planet *planet = new Planet(ws, vec2(0.0f), 0, 0, random);
+			planet->load(s);
+			addPlanet(planet);
+		} else 
+			(new BlackHole(ws, vec2(0.0f), 0, random))->load(s);
+	if(s.failed()) {
+		clear();
+		return false;
+	}
+	ws.buildGrids();
+	calcPlanetGraph();
+
+	SnapshotTable<Tree> trees;
+	SnapshotTable<Link> links;
+	for(std::vector<Planet*>::iterator pl = ws.planets.begin(); pl != ws.planets.end(); ++pl) 
+		if(!(*pl)->loadState(s, trees)) {
+			clear();
+			return false;
+		}
+	for(size_t i=0; i<trees.size(); ++i)
+		trees[i]->loadLinks(s, trees, links);
+	for(size_t i=0; i<trees.size(); ++i)
+		trees[i]->loadSeeders(s, links);
+	for(std::vector<Genus*>::iterator r = ws.genuses.begin(); r != ws.genuses.end(); ++r)
+		(*r)->loadTrees(s, trees);
+
+	createMinds();
+	if(!ai.load(s) || s.failed()) {
+		clear();
+		return false;
+	}
+
+	random = levelRandom;
+	if(race >= 0)
+		setCurrentRace(race);
+	currentLevel = selectedLevel = level;
+	levelTitle = std::string("LEVEL ") + to_string(currentLevel+1);
+	setScale(sc);
+	move(p);
 	state = ST_GAMEPLAY;
 	return true;
 }
 
+bool World::saveSnapshot(const char *path) {
+	SnapshotWriter s;
+	return saveSnapshot(s) && s.save(path);
+}
+
+bool World::loadSnapshot(const char *path) {
+	SnapshotReader s;
+	if(!s.load(path))
+		return false;
+	if(loadSnapshot(s))
+		return true;
+	remove(path);		// of another build or damaged, it would never load
+	return false;
+}
+
 void World::touchBegan(int id, int x, int y) {
 	if(id>1)
 		return;
@@ -576,7 +918,7 @@ bool World::checkFinishGame() {
 		sndGameOver.play();
 		return true;
 	}
-	for(std::vector<Genus*>::iterator r = genuses.begin(); r != genuses.end(); ++r) {
+	for(std::vector<Genus*>::iterator r = ws.genuses.begin(); r != ws.genuses.end(); ++r) {
 		if(*r == currentRace)
 			continue;
 		if(!(*r)->eliminated())
@@ -589,21 +931,59 @@ bool World::checkFinishGame() {
 	return true;
 }
 
+void World::getCounts(int &nodes, int &links) {
+	nodes = links = 0;
+	for(std::vector<Planet*>::iterator p = ws.planets.begin(); p != ws.planets.end(); ++p)
+		for(std::vector<Tree*>::iterator t = (*p)->trees.begin(); t != (*p)->trees.end(); ++t) {
+			nodes += (*t)->getCount();
+			links += (*t)->getLinksCount();
+		}
+}
+
 void World::setCurrentRace(int idx) {
-	if(idx < (int)genuses.size())
-		currentRace = genuses[idx];
+	if(idx < (int)ws.genuses.size()) {
+		currentRace = ws.genuses[idx];
+		if(recording)
+			recording->playerRace = idx;
+	}
 }
 
 void World::calcPlanetGraph() {
-	for(std::vector<Planet*>::iterator p1 = planets.begin(); p1 != planets.end()-1; ++p1) {
-		for(std::vector<Planet*>::iterator p2 = p1 + 1; p2 != planets.end(); ++p2) {
-			float dist = ((*p1)->pos - (*p2)->pos).length();
-			if(dist < (*p1)->maxLength)
-				(*p1)->addLink(*p2, dist);
-			if(dist < (*p2)->maxLength)
-				(*p2)->addLink(*p1, dist);
+	std::vector<int> near;
+	std::vector<Planet::PlanetLink> &links = ws.links;
+	links.clear();
+	for(std::vector<Planet*>::iterator p1 = ws.planets.begin(); p1 != ws.planets.end(); ++p1) {
+		Planet *p = *p1;
+		float maxLength2 = p->maxLength * p->maxLength;
+		near.clear();
+		SpatialGrid<Planet>::Query q(ws.planetsGrid, p->pos, p->maxLength);
+		while(Planet *p2 = q.next())
+			if(p2 != p && (p->pos - p2->pos).length2() < maxLength2)
+				near.push_back(p2->index);
+		std::sort(near.begin(), near.end());		// keep links in planet order, AI move order depends on it
+
+		p->linksBegin = links.size();
+		for(std::vector<int>::iterator i = near.begin(); i != near.end(); ++i) {
+			Planet *p2 = ws.planets[*i];
+			links.push_back(Planet::PlanetLink(p2, (p->pos - p2->pos).length()));
 		}
+		p->linksEnd = links.size();
 	}
+	for(std::vector<Planet*>::iterator p = ws.planets.begin(); p != ws.planets.end(); ++p)
+		for(int i = (*p)->linksBegin; i < (*p)->linksEnd; ++i)
+			links[i].back = links[i].planet->findLink(*p);
+	ws.blackList.assign(ws.genuses.size() * links.size(), -1.0f);
+}
+
+// the AI threads left over by the minds search for them, so a lone enemy uses every core
+void World::createMinds() {
+	ai.clear();
+	int minds = ws.genuses.size() - 1;
+	if(minds <= 0)
+		return;
+	int searchThreads = std::max(1, ai.getThreadCount() / minds);
+	for(int i=1; i<=minds; ++i)
+		ai.add(new Mind(this, i, aiDepth, searchThreads));
 }
 
 void World::keyDown(int kid) {
@@ -628,6 +1008,7 @@ void World::keyDown(int kid) {
 }
 
 void World::surrender() {
+	record(Replay::RC_SURRENDER, currentRace, 0, 0);
 	currentRace->clear();
 }
 
@@ -20,8 +20,13 @@
 #include "math2d.h"
 #include "color.h"
 #include "AI.h"
+#include "ThreadPool.h"
+#include "rand.h"
+#include "Replay.h"
+#include "Snapshot.h"
 #include "Render.h"
 #include "Sound.h"
+#include "WorldState.h"
 #include <vector>
 
 class Planet;
@@ -53,11 +58,31 @@ friend class Mind;
 	float 		scaleStart;
 	bool		touched[2];
 	Planet*		sourcePlanet;
+	WorldState	ws;					// must outlive ai, the minds read it until they are aborted
 	AI			ai;
+	ThreadPool	workers;			// planets are grown and stepped in parallel
+	Random		random;
+	unsigned int	seed;
+	float		steeringCell;		// of the levels that set none
+	unsigned int	tick;				// updates since the level was loaded
+	int			timeScale;			// game ticks per update
+	bool		skipping;			// ticks as many as fit in a frame until the level ends
+	Replay		*recording;
+	const Replay	*playback;
+	size_t		playbackPos, playbackCheckpoint;
+	int			playbackMismatches;
+
+	void	record(Replay::CommandType type, Genus *r, Planet *from, Planet *to);
+	void	playCommands(bool fromAI);
+	void	checkpoint();
+	void	step();
+	bool	link(Genus *r, Planet *from, Planet *to);
+	bool	unlink(Genus *r, Planet *from, Planet *to);
 	Render&		render;
 	std::string	levelTitle;
 
 	void	calcPlanetGraph();
+	void	createMinds();
 	void	drawAction();
 
 	enum	State {
@@ -107,16 +132,40 @@ public:
 
 	void	clear();
 	bool	loadLevel(const char *filename);
+	bool	loadLevelData(const char *name, const char *data);
 
 	Genus*	getCurrentRace()		{	return currentRace;	}
+	void	getCounts(int &nodes, int &links);
+	void	setThreadCount(int count)	{	workers.resize(count);	}
+	void	setSeed(unsigned int s)		{	seed = s;				}
+	void	setSteering(float cell)		{	steeringCell = cell;	}	// 0 turns the field off, for the levels loaded afterwards
+	Random&	getRandom()				{	return random;			}
+	WorldState&	getState()			{	return ws;				}
+	unsigned int	stateHash();
+
+	void	setRecording(Replay *r)	{	recording = r;			}	// filled by the levels loaded afterwards
+	bool	playReplay(const Replay *r);
+	bool	replayFinished()		{	return !playback || tick >= playback->ticks;	}
+	int		getReplayMismatches()	{	return playbackMismatches;	}
 	void	surrender();
 
+	bool	saveSnapshot(SnapshotWriter &s);	// the running level, false if there is none
+	bool	loadSnapshot(SnapshotReader &s);
+	bool	saveSnapshot(const char *path);
+	bool	loadSnapshot(const char *path);
+
 	void	startLevel(int idx);
 	void	nextLevel();
 
 	const char *getLevelTitle()		{	return levelTitle.c_str();	}
 	const color4& getTitleColor()	{	return titleColor;	}
 
+	void	setTimeScale(int s);
+	int		getTimeScale()			{	return timeScale;	}
+	void	skipToOutcome()			{	skipping = true;	}
+	void	stopSkipping()			{	skipping = false;	}
+	bool	isSkipping()			{	return skipping;	}
+
 	void	pause();
 	void	abort();
 };
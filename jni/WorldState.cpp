@@ -0,0 +1,43 @@
+/*  
+	Copyright (c) 2012, Alexey Saenko
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/ 
+
+#include "WorldState.h"
+
+void WorldState::clear() {
+	while(!planetObjects.empty()) {
+		delete planetObjects.back();
+		planetObjects.pop_back();
+	}
+	blackHoles.clear();
+	planets.clear();
+	planetObjectsGrid.clear();
+	planetsGrid.clear();
+	steering.clear();
+	links.clear();
+	blackList.clear();
+
+	while(!genuses.empty()) {
+		delete genuses.back();
+		genuses.pop_back();
+	}
+	arena.reset();
+}
+
+void WorldState::buildGrids() {
+	planetObjectsGrid.build(planetObjects, steeringRange);		// the objects are queried for the links they push
+	planetsGrid.build(planets);
+	if(steeringCell > 0)
+		steering.build(planetObjects, steeringCell);
+}
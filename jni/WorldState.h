@@ -0,0 +1,49 @@
+/*  
+	Copyright (c) 2012, Alexey Saenko
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/ 
+
+#ifndef WORLDSTATE_H
+#define WORLDSTATE_H
+
+#include "Planet.h"
+#include "Genus.h"
+#include "SpatialGrid.h"
+#include "SteeringField.h"
+#include "Arena.h"
+#include <vector>
+
+// Everything a level is made of. Planets, black holes and races register themselves here
+// when they are created, each World owns its own state, so several levels can run at once.
+class WorldState {
+public:
+	Arena						arena;			// trees, links and their buffers, freed at once by clear()
+	std::vector<PlanetObject*>	planetObjects;	// in the creation order, owns planets and black holes
+	std::vector<Planet*>		planets;
+	std::vector<BlackHole*>		blackHoles;
+	std::vector<Genus*>			genuses;
+	std::vector<Planet::PlanetLink>	links;		// adjacency of all planets, see Planet::linksBegin
+	std::vector<float>			blackList;		// by race and link, the cut distance or -1
+	SpatialGrid<PlanetObject>	planetObjectsGrid;
+	SpatialGrid<Planet>			planetsGrid;
+	SteeringField				steering;		// built for links to grow by when steeringCell is set
+	float						steeringCell;
+
+			WorldState(): steeringCell(0)	{}
+			~WorldState()			{	clear();	}
+	void	clear();
+	void	buildGrids();
+	float&	blackListed(int race, int link)		{	return blackList[race * links.size() + link];	}
+};
+
+#endif
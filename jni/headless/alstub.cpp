@@ -0,0 +1,60 @@
+/*  
+	Copyright (c) 2012, Alexey Saenko
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/ 
+
+// Silent OpenAL and Ogg Vorbis for the headless host: every device and
+// stream open fails, so Sound/MusicPlayer run their "no audio" paths.
+
+#include <AL/al.h>
+#include <AL/alc.h>
+#include <vorbis/vorbisfile.h>
+
+static ALuint lastName = 0;
+
+static void genNames(ALsizei n, ALuint *names) {
+	for(ALsizei i=0; i<n; ++i)
+		names[i] = ++lastName;
+}
+
+extern "C" {
+
+ALenum AL_APIENTRY alGetError()																{	return AL_NO_ERROR;		}
+void AL_APIENTRY alGenSources(ALsizei n, ALuint *sources)									{	genNames(n, sources);	}
+void AL_APIENTRY alDeleteSources(ALsizei, const ALuint*)									{}
+void AL_APIENTRY alSourcef(ALuint, ALenum, ALfloat)											{}
+void AL_APIENTRY alSource3f(ALuint, ALenum, ALfloat, ALfloat, ALfloat)						{}
+void AL_APIENTRY alSourcefv(ALuint, ALenum, const ALfloat*)									{}
+void AL_APIENTRY alSourcei(ALuint, ALenum, ALint)											{}
+void AL_APIENTRY alGetSourcei(ALuint, ALenum, ALint *value)									{	*value = 0;				}
+void AL_APIENTRY alSourcePlay(ALuint)														{}
+void AL_APIENTRY alSourceStop(ALuint)														{}
+void AL_APIENTRY alSourceQueueBuffers(ALuint, ALsizei, const ALuint*)						{}
+void AL_APIENTRY alSourceUnqueueBuffers(ALuint, ALsizei n, ALuint *buffers)					{	genNames(n, buffers);	}
+void AL_APIENTRY alGenBuffers(ALsizei n, ALuint *buffers)									{	genNames(n, buffers);	}
+void AL_APIENTRY alDeleteBuffers(ALsizei, const ALuint*)									{}
+void AL_APIENTRY alBufferData(ALuint, ALenum, const ALvoid*, ALsizei, ALsizei)				{}
+
+ALCcontext* ALC_APIENTRY alcCreateContext(ALCdevice*, const ALCint*)						{	return 0;				}
+ALCboolean ALC_APIENTRY alcMakeContextCurrent(ALCcontext*)									{	return ALC_FALSE;		}
+void ALC_APIENTRY alcDestroyContext(ALCcontext*)											{}
+ALCdevice* ALC_APIENTRY alcOpenDevice(const ALCchar*)										{	return 0;				}
+ALCboolean ALC_APIENTRY alcCloseDevice(ALCdevice*)											{	return ALC_FALSE;		}
+
+int ov_clear(OggVorbis_File*)																{	return 0;				}
+int ov_open_callbacks(void*, OggVorbis_File*, const char*, long, ov_callbacks)				{	return OV_ENOTVORBIS;	}
+int ov_pcm_seek(OggVorbis_File*, ogg_int64_t)												{	return OV_ENOSEEK;		}
+vorbis_info *ov_info(OggVorbis_File*, int)													{	return 0;				}
+long ov_read(OggVorbis_File*, char*, int, int, int, int, int*)								{	return 0;				}
+
+}
@@ -0,0 +1,815 @@
+/*  
+	Copyright (c) 2012, Alexey Saenko
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/ 
+
+// Headless simulation benchmark: loads every shipped level straight from the
+// assets directory and runs World::update() with GL and OpenAL stubbed out.
+//
+//	roots_bench [ticks] [root] [threads]	root is the directory that holds assets/,
+//											threads defaults to one per core
+//	roots_bench record <level> <ticks> <file> [root] [speed]
+//											plays a level against the AI at speed times
+//											real time and writes every command to file
+//	roots_bench replay <file> [root] [threads] [scale]
+//											re-runs a recorded game at full speed, prints
+//											per update percentiles and checks the state hashes,
+//											scale is the number of ticks per update
+//	roots_bench snapshot [ticks] [root]		plays every level for ticks, then times saving and
+//											restoring it and checks that nothing changed
+//	roots_bench worlds <count> <file> [root]	replays a recorded game in count worlds at once,
+//											one thread each, every one must match the recording
+//	roots_bench scale [ticks] [seed] [races]	generated levels of 10 to 10000 planets: load time,
+//											tick time and the time of one AI move search
+//	roots_bench generate <planets> [seed] [races] [black holes] [density] [tree size]
+//											prints a generated level, to be put in assets/levels
+//	roots_bench steering [root]				compares the steering field with the force of every object
+//											at several cell sizes, in error and time per growing step,
+//											then the paths of links grown both ways and how many split
+//	roots_bench search [depth] [ticks] [root]	plays every level for ticks, then searches a move of the
+//											first AI race with every depth limit up to depth, with and
+//											without the transposition table: nodes, msec, depth reached
+//	roots_bench smp [depth] [ticks] [root]	plays every level for ticks, then searches a move of the
+//											first AI race to depth on 1, 2, 4 and 8 threads: nodes,
+//											msec, nodes per msec and depth reached
+//	roots_bench profile <file> ...			runs any of the above with the phase profiler on and
+//											writes its statistics and last samples to file
+
+#include "../World.h"
+#include "../ResourceManager.h"
+#include "../Render.h"
+#include "../Sound.h"
+#include "../utils.h"
+#include "../Arena.h"
+#include "../Replay.h"
+#include "../Snapshot.h"
+#include "../platform.h"
+#include "../Profiler.h"
+#include "../Tree.h"
+#include "../Link.h"
+#include "levelgen.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
+#include <new>
+#include <pthread.h>
+
+static volatile unsigned long allocCount = 0, freeCount = 0;
+
+void* operator new(size_t size) {
+	__sync_fetch_and_add(&allocCount, 1);
+	void *p = malloc(size ? size : 1);
+	if(!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void *p) throw() {
+	if(!p)
+		return;
+	__sync_fetch_and_add(&freeCount, 1);
+	free(p);
+}
+
+void operator delete[](void *p) throw() {
+	operator delete(p);
+}
+
+void operator delete(void *p, size_t) throw() {
+	operator delete(p);
+}
+
+void operator delete[](void *p, size_t) throw() {
+	operator delete(p);
+}
+
+static double now() {
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+struct LevelStats {
+	double	loadTime, updateTime;
+	int		ticks, peakNodes, peakLinks;
+	unsigned long loadAllocs, updateAllocs, updateFrees;
+};
+
+static bool runLevel(World &world, int idx, int ticks, LevelStats &st) {
+	std::string name = std::string("level.") + to_string(idx);
+
+	unsigned long allocs = allocCount;
+	double t = now();
+	if(!world.loadLevel(name.c_str()))
+		return false;
+	st.loadTime = now() - t;
+	st.loadAllocs = allocCount - allocs;
+
+	st.ticks = ticks;
+	st.updateTime = 0;
+	st.peakNodes = st.peakLinks = 0;
+	st.updateAllocs = st.updateFrees = 0;
+	for(int i=0; i<ticks; ++i) {
+		allocs = allocCount;
+		unsigned long frees = freeCount;
+		t = now();
+		world.update();
+		st.updateTime += now() - t;
+		st.updateAllocs += allocCount - allocs;
+		st.updateFrees += freeCount - frees;
+
+		int nodes, links;
+		world.getCounts(nodes, links);
+		st.peakNodes = std::max(st.peakNodes, nodes);
+		st.peakLinks = std::max(st.peakLinks, links);
+	}
+	return true;
+}
+
+static int record(World &world, const char *level, int ticks, const char *path, float speed) {
+	Replay replay;
+	world.setRecording(&replay);
+	if(!world.loadLevel(level)) {
+		fprintf(stderr, "can't load %s\n", level);
+		return 1;
+	}
+
+	const double tickTime = 1.0 / 60.0 / speed;		// the AI thinks in wall clock time
+	double next = now();
+	for(int i=0; i<ticks; ++i) {
+		world.update();
+		next += tickTime;
+		double wait = next - now();
+		if(wait > 0)
+			platform::sleep((unsigned int)(wait * 1000.0));
+	}
+	world.setRecording(0);
+
+	if(replay.overflow) {
+		fprintf(stderr, "%s has more races or planets than a replay can hold\n", level);
+		return 1;
+	}
+	if(!replay.save(path)) {
+		fprintf(stderr, "can't write %s\n", path);
+		return 1;
+	}
+	printf("%s: %u ticks, %d commands, %d checkpoints\n", level, replay.ticks, (int)replay.commands.size(), (int)replay.checkpoints.size());
+	return 0;
+}
+
+static double percentile(const std::vector<double> &sorted, double p) {
+	size_t i = std::min(sorted.size() - 1, (size_t)(p * (sorted.size() - 1) + 0.5));
+	return sorted[i];
+}
+
+static int replay(World &world, const char *path, int scale) {
+	Replay replay;
+	if(!replay.load(path)) {
+		fprintf(stderr, "can't read %s\n", path);
+		return 1;
+	}
+	if(!world.playReplay(&replay)) {
+		fprintf(stderr, "can't load %s\n", replay.level.c_str());
+		return 1;
+	}
+	world.setTimeScale(scale);
+
+	std::vector<double> times;
+	times.reserve(replay.ticks);
+	double total = 0;
+	while(!world.replayFinished()) {
+		double t = now();
+		world.update();
+		t = now() - t;
+		times.push_back(t);
+		total += t;
+	}
+	if(times.empty())
+		return 1;
+	std::sort(times.begin(), times.end());
+
+	printf("%s: %u ticks in %d updates, %d commands, %.0f ticks/sec\n", replay.level.c_str(), replay.ticks, (int)times.size(),
+			(int)replay.commands.size(), replay.ticks / total);
+	printf("update us: p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+			percentile(times, 0.5) * 1e6, percentile(times, 0.9) * 1e6, percentile(times, 0.99) * 1e6,
+			percentile(times, 0.999) * 1e6, times.back() * 1e6);
+	int mismatches = world.getReplayMismatches();
+	printf("checkpoints: %d of %d differ\n", mismatches, (int)replay.checkpoints.size());
+	return mismatches ? 2 : 0;
+}
+
+static const int snapshotRuns = 20;
+
+// worst of several runs, a restore clears the level and builds it again every time
+static bool snapshotLevel(World &world, int idx, int ticks) {
+	std::string name = std::string("level.") + to_string(idx);
+	if(!world.loadLevel(name.c_str()))
+		return false;
+	for(int i=0; i<ticks; ++i)
+		world.update();
+	unsigned int hash = world.stateHash();
+
+	SnapshotWriter s;
+	double save = 0;
+	for(int i=0; i<snapshotRuns; ++i) {
+		s.clear();
+		double t = now();
+		world.saveSnapshot(s);
+		save = std::max(save, now() - t);
+	}
+	std::vector<unsigned char> data = s.getData();
+
+	const char *path = "roots_bench.snapshot";
+	double t = now();
+	s.save(path);
+	double write = now() - t;
+
+	SnapshotReader r;
+	t = now();
+	r.load(path);
+	double read = now() - t;
+	remove(path);
+
+	double restore = 0;
+	bool ok = true;
+	for(int i=0; i<snapshotRuns; ++i) {
+		r.reset(data);
+		t = now();
+		ok = world.loadSnapshot(r) && ok;
+		restore = std::max(restore, now() - t);
+	}
+
+	ok = ok && world.stateHash() == hash;
+	s.clear();
+	world.saveSnapshot(s);
+	ok = ok && s.getData() == data;			// the restored level saves to the same bytes
+
+	printf("level.%-4d %9.1f %9.3f %9.3f %9.3f %9.3f  %s\n", idx, data.size() / 1024.0,
+			save * 1000.0, write * 1000.0, read * 1000.0, restore * 1000.0, ok ? "ok" : "MISMATCH");
+	return ok;
+}
+
+static int snapshot(World &world, int ticks) {
+	printf("%-10s %9s %9s %9s %9s %9s\n", "level", "KB", "save ms", "write ms", "read ms", "restore ms");
+	int levels = 0, failed = 0;
+	for(int idx=0; ; ++idx) {
+		std::string name = std::string("assets/levels/level.") + to_string(idx);
+		int size;
+		void *data = ResourceManager::instance()->loadFile(name.c_str(), size);
+		if(!data)
+			break;
+		delete (char*)data;
+		if(!snapshotLevel(world, idx, ticks))
+			failed++;
+		levels++;
+	}
+	return levels == 0 || failed ? 1 : 0;
+}
+
+static void* runWorld(void *arg) {
+	World *world = (World*)arg;
+	while(!world->replayFinished())
+		world->update();
+	return 0;
+}
+
+// the levels are loaded one by one, then every world ticks on its own thread
+static int worlds(const char *path, int count) {
+	Replay replay;
+	if(!replay.load(path)) {
+		fprintf(stderr, "can't read %s\n", path);
+		return 1;
+	}
+	std::vector<World*> worlds;
+	int rc = 0;
+	for(int i=0; i<count && !rc; ++i) {
+		World *world = new World();
+		world->setThreadCount(1);
+		worlds.push_back(world);
+		if(!world->playReplay(&replay)) {
+			fprintf(stderr, "can't load %s\n", replay.level.c_str());
+			rc = 1;
+		}
+	}
+
+	if(!rc) {
+		std::vector<pthread_t> threads(count);
+		double t = now();
+		for(int i=0; i<count; ++i)
+			pthread_create(&threads[i], 0, runWorld, worlds[i]);
+		for(int i=0; i<count; ++i)
+			pthread_join(threads[i], 0);
+		t = now() - t;
+
+		int differ = 0;
+		for(int i=0; i<count; ++i)
+			if(worlds[i]->getReplayMismatches() || worlds[i]->stateHash() != worlds[0]->stateHash())
+				differ++;
+		printf("%s: %d worlds of %u ticks in %.2f s, %.0f ticks/sec, %d differ\n", replay.level.c_str(), count,
+				replay.ticks, t, count * replay.ticks / t, differ);
+		rc = differ ? 2 : 0;
+	}
+	for(std::vector<World*>::iterator w = worlds.begin(); w != worlds.end(); ++w)
+		delete *w;
+	return rc;
+}
+
+static const int scalePlanets[] = { 10, 100, 1000, 10000 };
+static const int aiSearches = 3;
+
+// a fresh mind of the first AI race searches the position the ticks left, the world's own AI is stopped first
+static int scale(World &world, int ticks, unsigned int seed, int races) {
+	printf("%-8s %7s %9s %9s %9s %9s %8s %8s %9s %9s\n", "planets", "KB", "gen ms", "load ms",
+			"tick us", "p99 us", "nodes", "links", "AI ms", "AI max");
+	for(size_t i=0; i<sizeof(scalePlanets)/sizeof(scalePlanets[0]); ++i) {
+		LevelGenParams params(scalePlanets[i]);
+		params.seed = seed;
+		params.races = races;
+
+		double t = now();
+		std::string level = generateLevel(params);
+		double gen = now() - t;
+
+		std::string name = std::string("stress.") + to_string(params.planets);
+		t = now();
+		if(!world.loadLevelData(name.c_str(), level.c_str())) {
+			fprintf(stderr, "can't parse the generated %s\n", name.c_str());
+			return 1;
+		}
+		double load = now() - t;
+
+		std::vector<double> times;
+		times.reserve(ticks);
+		double total = 0;
+		int nodes = 0, links = 0;
+		for(int k=0; k<ticks; ++k) {
+			t = now();
+			world.update();
+			t = now() - t;
+			times.push_back(t);
+			total += t;
+		}
+		world.getCounts(nodes, links);
+		std::sort(times.begin(), times.end());
+		world.abort();
+
+		double search = 0, searchMax = 0;
+		for(int k=0; k<aiSearches; ++k) {
+			Mind mind(&world, std::min(1, races-1), 3);
+			t = now();
+			mind.update();
+			mind.threadUpdate();
+			t = now() - t;
+			search += t;
+			searchMax = std::max(searchMax, t);
+		}
+
+		printf("%-8d %7.0f %9.2f %9.2f %9.1f %9.1f %8d %8d %9.1f %9.1f\n", params.planets, level.size() / 1024.0,
+				gen * 1000.0, load * 1000.0, total / std::max(1, ticks) * 1e6, times.empty() ? 0 : percentile(times, 0.99) * 1e6,
+				nodes, links, search / aiSearches * 1000.0, searchMax * 1000.0);
+		fflush(stdout);
+	}
+	return 0;
+}
+
+static const float steeringCells[] = { 0.05f, 0.1f, 0.2f, 0.4f };
+static const int steeringSamples = 200000;
+static const float steeringStep = 0.015f;			// normalLinkGrowingStep
+
+// the current model moves the link past the objects one after another, the field takes the sum at the start
+static vec2 steeringStepExact(WorldState &ws, const vec2 &p, float v) {
+	vec2 pos = p;
+	SpatialGrid<PlanetObject>::Query q(ws.planetObjectsGrid, pos, 2.0f*v);
+	while(PlanetObject *obj = q.next()) {
+		vec2 delta;
+		float f = steeringForce(obj->getPos(), obj->getRadius(), pos, delta);
+		if(f < 1.0f)
+			pos += delta * (f * v * steeringObstacle);
+	}
+	return pos - p;
+}
+
+// errors are in growing steps, the points are taken where some object pushes
+static void steeringAccuracy(World &world, const char *name) {
+	WorldState &ws = world.getState();
+	Random rnd(7);
+	std::vector<vec2> samples;
+	for(int i=0; i<steeringSamples; ++i) {
+		PlanetObject *o = ws.planetObjects[rnd.next() % ws.planetObjects.size()];
+		float r = steeringRange * o->getRadius() * sqrtf(rnd.next() / 4294967296.0f);
+		samples.push_back(o->getPos() + rnd.randVec2() * r);
+	}
+	std::vector<vec2> exact(samples.size(), vec2(0, 0));
+	double t = now();
+	for(size_t i=0; i<samples.size(); ++i)
+		exact[i] = steeringStepExact(ws, samples[i], steeringStep);
+	double exactTime = now() - t;
+	float meanPush = 0;
+	for(size_t i=0; i<samples.size(); ++i) {
+		exact[i] /= steeringStep;
+		meanPush += exact[i].length() / samples.size();
+	}
+
+	for(size_t c=0; c<sizeof(steeringCells)/sizeof(steeringCells[0]); ++c) {
+		SteeringField field;
+		double buildTime = now();
+		field.build(ws.planetObjects, steeringCells[c]);
+		buildTime = now() - buildTime;
+		std::vector<vec2> pushes(samples.size(), vec2(0, 0));
+		double sampleTime = now();
+		for(size_t i=0; i<samples.size(); ++i)
+			pushes[i] = field.sample(samples[i]);
+		sampleTime = now() - sampleTime;
+		std::vector<double> errors;
+		double mean = 0, angle = 0;
+		for(size_t i=0; i<samples.size(); ++i) {
+			const vec2 &push = pushes[i];
+			double e = (push - exact[i]).length();
+			errors.push_back(e);
+			mean += e / samples.size();
+			vec2 d0 = vec2(1, 0) + exact[i], d1 = vec2(1, 0) + push;		// a link heading along x
+			angle += fabs(atan2f(d0.x*d1.y - d0.y*d1.x, d0 * d1)) / samples.size();
+		}
+		std::sort(errors.begin(), errors.end());
+		printf("%-11s %5.2f %8.2f %7.0f %6.3f %6.3f %6.3f %6.3f %6.2f %7.1f %7.1f\n", name, steeringCells[c], buildTime * 1000.0,
+				field.getMemory() / 1024.0, meanPush, mean, percentile(errors, 0.99), errors.back(), angle * 180.0 / PI,
+				exactTime * 1e9 / samples.size(), sampleTime * 1e9 / samples.size());
+	}
+}
+
+static const int steeringPathTargets = 3;			// the nearest planets every tree grows a link to
+static const int steeringPathLinks = 1500;			// per level, the stress levels have thousands of trees
+static const float steeringSplit = 4.0f;			// growing steps, links further apart went round an object the other way
+
+struct SteeringPath {
+	Tree	*tree;
+	Planet	*target;
+	std::vector<vec2>	tips;			// after every growing step
+	bool	arrived;
+};
+
+// The links are grown alone, outside of their trees. A link that arrives is left in its planet's
+// pending list, so the level has to be loaded again before it ticks.
+static double growSteeringPaths(WorldState &ws, std::vector<SteeringPath> &paths) {
+	double time = 0;
+	for(size_t i=0; i<paths.size(); ++i) {
+		SteeringPath &path = paths[i];
+		Link *link = new(ws.arena) Link(path.tree, path.target);
+		int maxSteps = (int)(3.0f * (path.target->getPos() - path.tree->getPos()).length() / steeringStep) + 100;
+		path.tips.clear();
+		double t = now();
+		for(int s=0; s<maxSteps && link->isGrowing(); ++s) {
+			link->stepUp(steeringStep);
+			path.tips.push_back(link->getTip());
+		}
+		time += now() - t;
+		path.arrived = !link->isGrowing();
+		delete link;
+	}
+	return time;
+}
+
+// The same links grown by the force of every object and by the field, distances in growing steps.
+// The field sums the pushes the objects apply one after another, so next to two objects a link
+// may pass them on the other side: those are counted as split, they are why the field is opt-in.
+static void steeringPaths(World &world, const char *name) {
+	WorldState &ws = world.getState();
+	std::vector<SteeringPath> exact;
+	for(size_t p=0; p<ws.planets.size() && exact.size() < (size_t)steeringPathLinks; ++p)
+		for(size_t r=0; r<ws.genuses.size(); ++r) {
+			Tree *tree = ws.planets[p]->getTree(ws.genuses[r]);
+			if(!tree)
+				continue;
+			std::vector<std::pair<float, Planet*> > nearest;
+			for(size_t t=0; t<ws.planets.size(); ++t)
+				if(t != p)
+					nearest.push_back(std::make_pair((ws.planets[t]->getPos() - ws.planets[p]->getPos()).length(), ws.planets[t]));
+			size_t n = std::min(nearest.size(), (size_t)steeringPathTargets);
+			std::partial_sort(nearest.begin(), nearest.begin() + n, nearest.end());
+			for(size_t t=0; t<n; ++t) {
+				SteeringPath path;
+				path.tree = tree;
+				path.target = nearest[t].second;
+				exact.push_back(path);
+			}
+		}
+	if(exact.empty())
+		return;
+	std::vector<SteeringPath> field(exact);
+	ws.steering.clear();
+	double exactTime = growSteeringPaths(ws, exact);
+	ws.steering.build(ws.planetObjects, defaultSteeringCell);
+	double fieldTime = growSteeringPaths(ws, field);
+	ws.steering.clear();
+
+	std::vector<double> errors;
+	double mean = 0, stepsDiff = 0;
+	size_t exactSteps = 0, fieldSteps = 0;
+	int arrived = 0, split = 0;
+	for(size_t i=0; i<exact.size(); ++i) {
+		const std::vector<vec2> &a = exact[i].tips, &b = field[i].tips;
+		exactSteps += a.size();
+		fieldSteps += b.size();
+		float apart = 0;
+		for(size_t s=0; s<std::min(a.size(), b.size()); ++s) {
+			errors.push_back((a[s] - b[s]).length() / steeringStep);
+			apart = std::max(apart, (float)errors.back());
+		}
+		if(apart > steeringSplit)
+			++split;
+		if(exact[i].arrived && field[i].arrived) {
+			++arrived;
+			stepsDiff += fabs((double)a.size() - (double)b.size());
+		}
+	}
+	for(size_t i=0; i<errors.size(); ++i)
+		mean += errors[i] / errors.size();
+	std::sort(errors.begin(), errors.end());
+	printf("%-11s %5d %5d %7.1f %7.1f %6.2f %6.2f %6.2f %6.1f %6.1f %7.1f %7.1f\n", name, (int)exact.size(), split,
+			(double)exactSteps / exact.size(), (double)fieldSteps / exact.size(), mean, percentile(errors, 0.99), errors.back(),
+			arrived * 100.0 / exact.size(), arrived ? stepsDiff / arrived : 0.0,
+			exactTime * 1e9 / exactSteps, fieldTime * 1e9 / fieldSteps);
+}
+
+static int steering(World &world) {
+	printf("%-11s %5s %8s %7s %6s %6s %6s %6s %6s %7s %7s\n",
+			"level", "cell", "build ms", "KB", "push", "error", "p99", "max", "turn", "objs ns", "field ns");
+	for(int idx=0; ; ++idx) {
+		std::string name = std::string("level.") + to_string(idx);
+		world.setSteering(0);
+		if(!world.loadLevel(name.c_str()))
+			break;
+		steeringAccuracy(world, name.c_str());
+	}
+	for(size_t i=0; i<sizeof(scalePlanets)/sizeof(scalePlanets[0]); ++i) {
+		std::string name = std::string("stress.") + to_string(scalePlanets[i]);
+		world.loadLevelData(name.c_str(), generateLevel(LevelGenParams(scalePlanets[i])).c_str());
+		steeringAccuracy(world, name.c_str());
+	}
+
+	printf("\n%-11s %5s %5s %7s %7s %6s %6s %6s %6s %6s %7s %7s\n",
+			"level", "links", "split", "steps", "field", "apart", "p99", "max", "both %", "steps", "objs ns", "field ns");
+	for(int idx=0; ; ++idx) {
+		std::string name = std::string("level.") + to_string(idx);
+		if(!world.loadLevel(name.c_str()))
+			break;
+		steeringPaths(world, name.c_str());
+	}
+	for(size_t i=0; i<sizeof(scalePlanets)/sizeof(scalePlanets[0]); ++i) {
+		std::string name = std::string("stress.") + to_string(scalePlanets[i]);
+		world.loadLevelData(name.c_str(), generateLevel(LevelGenParams(scalePlanets[i])).c_str());
+		steeringPaths(world, name.c_str());
+	}
+	return 0;
+}
+
+static const int searchBudget = 2000;			// msec, Mind::searchBestMove() cuts the depth after it
+
+static int search(World &world, int maxDepth, int ticks) {
+	printf("%-10s %5s %10s %9s %7s %10s %9s %7s\n", "level", "depth", "nodes", "ms", "reached", "TT nodes", "TT ms", "reached");
+	std::vector<double> total[2];
+	std::vector<int> overBudget[2];
+	for(int idx=0; ; ++idx) {
+		std::string name = std::string("level.") + to_string(idx);
+		if(!world.loadLevel(name.c_str()))
+			break;
+		for(int i=0; i<ticks; ++i)
+			world.update();
+		world.abort();
+
+		for(int depth=1; depth<=maxDepth; ++depth) {
+			unsigned long nodes[2];
+			double times[2];
+			int reached[2];
+			for(int tt=0; tt<2; ++tt) {
+				Mind mind(&world, 1, depth);
+				mind.setTransTable(tt != 0);
+				double t = now();
+				mind.update();
+				mind.threadUpdate();
+				times[tt] = now() - t;
+				nodes[tt] = mind.getNodes();
+				reached[tt] = mind.getSearchDepth();
+				total[tt].resize(maxDepth);
+				overBudget[tt].resize(maxDepth);
+				total[tt][depth-1] += times[tt];
+				overBudget[tt][depth-1] += times[tt] * 1000.0 > searchBudget;
+			}
+			printf("%-10s %5d %10lu %9.1f %7d %10lu %9.1f %7d\n", name.c_str(), depth, nodes[0], times[0] * 1000.0, reached[0],
+					nodes[1], times[1] * 1000.0, reached[1]);
+			fflush(stdout);
+		}
+	}
+	if(total[0].empty())
+		return 1;
+	printf("\n%5s %12s %12s %12s %12s\n", "depth", "total ms", "over budget", "TT total ms", "TT over");
+	for(int depth=1; depth<=maxDepth; ++depth)
+		printf("%5d %12.0f %12d %12.0f %12d\n", depth, total[0][depth-1] * 1000.0, overBudget[0][depth-1],
+				total[1][depth-1] * 1000.0, overBudget[1][depth-1]);
+	return 0;
+}
+
+static const int smpThreads[] = { 1, 2, 4, 8 };
+static const int smpRuns = sizeof(smpThreads)/sizeof(smpThreads[0]);
+
+static int smp(World &world, int depth, int ticks) {
+	printf("%-10s", "level");
+	for(int i=0; i<smpRuns; ++i)
+		printf(" %7s%d %7s%d %3s%d", "nodes", smpThreads[i], "ms", smpThreads[i], "d", smpThreads[i]);
+	printf("\n");
+	double nodes[smpRuns] = { 0 }, times[smpRuns] = { 0 };
+	int levels = 0;
+	for(int idx=0; ; ++idx) {
+		std::string name = std::string("level.") + to_string(idx);
+		if(!world.loadLevel(name.c_str()))
+			break;
+		for(int i=0; i<ticks; ++i)
+			world.update();
+		world.abort();
+
+		printf("%-10s", name.c_str());
+		for(int i=0; i<smpRuns; ++i) {
+			Mind mind(&world, 1, depth, smpThreads[i]);
+			double t = now();
+			mind.update();
+			mind.threadUpdate();
+			t = now() - t;
+			nodes[i] += mind.getNodes();
+			times[i] += t;
+			printf(" %8lu %8.1f %4d", mind.getNodes(), t * 1000.0, mind.getSearchDepth());
+		}
+		printf("\n");
+		fflush(stdout);
+		levels++;
+	}
+	if(!levels)
+		return 1;
+	printf("\n%7s %12s %12s %12s %9s\n", "threads", "total nodes", "total ms", "nodes/ms", "scaling");
+	for(int i=0; i<smpRuns; ++i)
+		printf("%7d %12.0f %12.0f %12.1f %9.2f\n", smpThreads[i], nodes[i], times[i] * 1000.0, nodes[i] / (times[i] * 1000.0),
+				nodes[i] / times[i] / (nodes[0] / times[0]));
+	return 0;
+}
+
+static void shutdown(World *world) {
+	delete world;
+	Render::destroy();
+	Sound::destroy();
+	ResourceManager::destroy();
+}
+
+static int run(int argc, char **argv) {
+	if(argc > 4 && !strcmp(argv[1], "record")) {
+		ResourceManager::init(argc > 5 ? argv[5] : ".");
+		World *world = new World();
+		int rc = record(*world, argv[2], atoi(argv[3]), argv[4], argc > 6 ? atof(argv[6]) : 1.0f);
+		shutdown(world);
+		return rc;
+	}
+	if(argc > 2 && !strcmp(argv[1], "replay")) {
+		ResourceManager::init(argc > 3 ? argv[3] : ".");
+		World *world = new World();
+		if(argc > 4)
+			world->setThreadCount(atoi(argv[4]));
+		int rc = replay(*world, argv[2], argc > 5 ? atoi(argv[5]) : 1);
+		shutdown(world);
+		return rc;
+	}
+
+	if(argc > 1 && !strcmp(argv[1], "snapshot")) {
+		ResourceManager::init(argc > 3 ? argv[3] : ".");
+		World *world = new World();
+		int rc = snapshot(*world, argc > 2 ? atoi(argv[2]) : 2000);
+		shutdown(world);
+		return rc;
+	}
+
+	if(argc > 2 && !strcmp(argv[1], "generate")) {
+		LevelGenParams params(atoi(argv[2]));
+		if(argc > 3)	params.seed = atoi(argv[3]);
+		if(argc > 4)	params.races = atoi(argv[4]);
+		if(argc > 5)	params.blackHoles = atoi(argv[5]);
+		if(argc > 6)	params.density = atof(argv[6]);
+		if(argc > 7)	params.treeSize = atof(argv[7]);
+		fputs(generateLevel(params).c_str(), stdout);
+		return 0;
+	}
+
+	if(argc > 1 && !strcmp(argv[1], "steering")) {
+		ResourceManager::init(argc > 2 ? argv[2] : ".");
+		World *world = new World();
+		int rc = steering(*world);
+		shutdown(world);
+		return rc;
+	}
+
+	if(argc > 1 && !strcmp(argv[1], "search")) {
+		ResourceManager::init(argc > 4 ? argv[4] : ".");
+		World *world = new World();
+		int rc = search(*world, argc > 2 ? atoi(argv[2]) : 4, argc > 3 ? atoi(argv[3]) : 600);
+		shutdown(world);
+		return rc;
+	}
+
+	if(argc > 1 && !strcmp(argv[1], "smp")) {
+		ResourceManager::init(argc > 4 ? argv[4] : ".");
+		World *world = new World();
+		int rc = smp(*world, argc > 2 ? atoi(argv[2]) : 4, argc > 3 ? atoi(argv[3]) : 600);
+		shutdown(world);
+		return rc;
+	}
+
+	if(argc > 1 && !strcmp(argv[1], "scale")) {
+		ResourceManager::init(".");
+		World *world = new World();
+		int rc = scale(*world, argc > 2 ? atoi(argv[2]) : 500, argc > 3 ? atoi(argv[3]) : 1, argc > 4 ? std::max(1, atoi(argv[4])) : 3);
+		shutdown(world);
+		return rc;
+	}
+
+	if(argc > 3 && !strcmp(argv[1], "worlds")) {
+		ResourceManager::init(argc > 4 ? argv[4] : ".");
+		int rc = worlds(argv[3], std::max(1, atoi(argv[2])));
+		shutdown(0);
+		return rc;
+	}
+
+	int ticks = argc > 1 ? atoi(argv[1]) : 2000;
+	const char *root = argc > 2 ? argv[2] : ".";
+	int threads = argc > 3 ? atoi(argv[3]) : 0;
+
+	ResourceManager::init(root);
+	World *world = new World();
+	if(threads > 0)
+		world->setThreadCount(threads);
+
+	printf("%-10s %9s %9s %12s %8s %8s %10s %10s %10s\n",
+			"level", "load ms", "ticks", "ticks/sec", "nodes", "links", "load new", "tick new", "tick del");
+
+	LevelStats total = LevelStats();
+	int levels = 0;
+	for(int idx=0; ; ++idx) {
+		LevelStats st;
+		if(!runLevel(*world, idx, ticks, st))
+			break;
+		printf("level.%-4d %9.2f %9d %12.0f %8d %8d %10lu %10lu %10lu\n", idx,
+				st.loadTime * 1000.0, st.ticks, st.ticks / st.updateTime,
+				st.peakNodes, st.peakLinks, st.loadAllocs, st.updateAllocs, st.updateFrees);
+		total.loadTime += st.loadTime;
+		total.updateTime += st.updateTime;
+		total.ticks += st.ticks;
+		total.loadAllocs += st.loadAllocs;
+		total.updateAllocs += st.updateAllocs;
+		total.updateFrees += st.updateFrees;
+		total.peakNodes = std::max(total.peakNodes, st.peakNodes);
+		total.peakLinks = std::max(total.peakLinks, st.peakLinks);
+		levels++;
+	}
+	if(levels == 0) {
+		fprintf(stderr, "no levels found under %s/assets/levels\n", root);
+		return 1;
+	}
+	printf("%-10s %9.2f %9d %12.0f %8d %8d %10lu %10lu %10lu\n", "total",
+			total.loadTime * 1000.0, total.ticks, total.ticks / total.updateTime,
+			total.peakNodes, total.peakLinks, total.loadAllocs, total.updateAllocs, total.updateFrees);
+
+	const Arena::Stats &as = world->getState().arena.getStats();
+	printf("arena: %lu KB reserved in %lu heap blocks, peak %lu KB, %lu allocs, %lu frees\n",
+			(unsigned long)as.reserved / 1024, as.heapAllocs, (unsigned long)as.peak / 1024, as.allocs, as.frees);
+
+	shutdown(world);
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	if(argc < 3 || strcmp(argv[1], "profile"))
+		return run(argc, argv);
+
+	const char *path = argv[2];
+	Profiler::setEnabled(true);
+	int rc = run(argc - 2, argv + 2);
+	if(!Profiler::instance().dump(path)) {
+		fprintf(stderr, "can't write %s\n", path);
+		rc = 1;
+	}
+	Profiler::destroy();
+	return rc;
+}
@@ -0,0 +1,93 @@
+/*  
+	Copyright (c) 2012, Alexey Saenko
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/ 
+
+// No-op OpenGL ES 2.0 for the headless host: object names are handed out so
+// that VBO/FBO/Shader bookkeeping behaves, nothing is ever drawn.
+
+#include "../opengl.h"
+#include <string.h>
+
+static GLuint lastName = 0;
+
+static void genNames(GLsizei n, GLuint *names) {
+	for(GLsizei i=0; i<n; ++i)
+		names[i] = ++lastName;
+}
+
+extern "C" {
+
+void GL_APIENTRY glActiveTexture(GLenum)															{}
+void GL_APIENTRY glAttachShader(GLuint, GLuint)														{}
+void GL_APIENTRY glBindAttribLocation(GLuint, GLuint, const GLchar*)								{}
+void GL_APIENTRY glBindBuffer(GLenum, GLuint)														{}
+void GL_APIENTRY glBindFramebuffer(GLenum, GLuint)													{}
+void GL_APIENTRY glBindTexture(GLenum, GLuint)														{}
+void GL_APIENTRY glBlendFunc(GLenum, GLenum)														{}
+void GL_APIENTRY glBufferData(GLenum, GLsizeiptr, const void*, GLenum)								{}
+void GL_APIENTRY glBufferSubData(GLenum, GLintptr, GLsizeiptr, const void*)							{}
+GLenum GL_APIENTRY glCheckFramebufferStatus(GLenum)													{	return GL_FRAMEBUFFER_COMPLETE;	}
+void GL_APIENTRY glClear(GLbitfield)																{}
+void GL_APIENTRY glClearColor(GLfloat, GLfloat, GLfloat, GLfloat)									{}
+void GL_APIENTRY glCompileShader(GLuint)															{}
+void GL_APIENTRY glCopyTexSubImage2D(GLenum, GLint, GLint, GLint, GLint, GLint, GLsizei, GLsizei)	{}
+GLuint GL_APIENTRY glCreateProgram()																{	return ++lastName;	}
+GLuint GL_APIENTRY glCreateShader(GLenum)															{	return ++lastName;	}
+void GL_APIENTRY glDeleteBuffers(GLsizei, const GLuint*)											{}
+void GL_APIENTRY glDeleteFramebuffers(GLsizei, const GLuint*)										{}
+void GL_APIENTRY glDeleteProgram(GLuint)															{}
+void GL_APIENTRY glDeleteShader(GLuint)																{}
+void GL_APIENTRY glDeleteTextures(GLsizei, const GLuint*)											{}
+void GL_APIENTRY glDisable(GLenum)																	{}
+void GL_APIENTRY glDisableVertexAttribArray(GLuint)													{}
+void GL_APIENTRY glDrawArrays(GLenum, GLint, GLsizei)												{}
+void GL_APIENTRY glDrawElements(GLenum, GLsizei, GLenum, const void*)								{}
+void GL_APIENTRY glEnable(GLenum)																	{}
+void GL_APIENTRY glEnableVertexAttribArray(GLuint)													{}
+void GL_APIENTRY glFramebufferTexture2D(GLenum, GLenum, GLenum, GLuint, GLint)						{}
+void GL_APIENTRY glGenBuffers(GLsizei n, GLuint *buffers)											{	genNames(n, buffers);	}
+void GL_APIENTRY glGenFramebuffers(GLsizei n, GLuint *framebuffers)									{	genNames(n, framebuffers);	}
+void GL_APIENTRY glGenTextures(GLsizei n, GLuint *textures)											{	genNames(n, textures);	}
+GLint GL_APIENTRY glGetUniformLocation(GLuint, const GLchar*)										{	return -1;	}
+void GL_APIENTRY glLineWidth(GLfloat)																{}
+void GL_APIENTRY glLinkProgram(GLuint)																{}
+void GL_APIENTRY glTexImage2D(GLenum, GLint, GLint, GLsizei, GLsizei, GLint, GLenum, GLenum, const void*)	{}
+void GL_APIENTRY glTexParameterf(GLenum, GLenum, GLfloat)											{}
+void GL_APIENTRY glTexParameteri(GLenum, GLenum, GLint)												{}
+void GL_APIENTRY glUniform1f(GLint, GLfloat)														{}
+void GL_APIENTRY glUniform1i(GLint, GLint)															{}
+void GL_APIENTRY glUniform2fv(GLint, GLsizei, const GLfloat*)										{}
+void GL_APIENTRY glUniform4fv(GLint, GLsizei, const GLfloat*)										{}
+void GL_APIENTRY glUniformMatrix4fv(GLint, GLsizei, GLboolean, const GLfloat*)						{}
+void GL_APIENTRY glUseProgram(GLuint)																{}
+void GL_APIENTRY glVertexAttribPointer(GLuint, GLint, GLenum, GLboolean, GLsizei, const void*)		{}
+void GL_APIENTRY glViewport(GLint, GLint, GLsizei, GLsizei)											{}
+
+void GL_APIENTRY glShaderSource(GLuint, GLsizei, const GLchar *const*, const GLint*)				{}
+
+void GL_APIENTRY glGetShaderInfoLog(GLuint, GLsizei bufSize, GLsizei *length, GLchar *infoLog) {
+	if(length)
+		*length = 0;
+	if(bufSize > 0)
+		infoLog[0] = 0;
+}
+
+void GL_APIENTRY glGetProgramInfoLog(GLuint, GLsizei bufSize, GLsizei *length, GLchar *infoLog) {
+	if(length)
+		*length = 0;
+	if(bufSize > 0)
+		infoLog[0] = 0;
+}
+
+}
@@ -0,0 +1,95 @@
+/*  
+	Copyright (c) 2012, Alexey Saenko
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/ 
+
+#include "levelgen.h"
+#include "../rand.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+static void append(std::string &s, const char *fmt, ...) {
+	char buf[128];
+	va_list args;
+	va_start(args, fmt);
+	vsnprintf(buf, sizeof(buf), fmt, args);
+	va_end(args);
+	s += buf;
+}
+
+static const float palette[][3] = {
+	{ 0.0f, 1.0f, 0.0f },		// the player, as in the shipped levels
+	{ 0.1f, 0.7f, 0.5f },
+	{ 1.0f, 0.1f, 0.5f },
+	{ 1.0f, 0.6f, 0.1f },
+	{ 0.3f, 0.4f, 1.0f },
+	{ 0.9f, 0.9f, 0.2f }
+};
+static const int paletteSize = sizeof(palette) / sizeof(palette[0]);
+
+std::string generateLevel(const LevelGenParams &p) {
+	Random rnd(p.seed);
+	int races = std::max(1, p.races);
+	int count = std::max(1, p.planets) + std::max(0, p.blackHoles);
+	int cols = (int)ceilf(sqrtf((float)count));
+	float spacing = 1.0f / sqrtf(p.density);
+
+	// cell kinds: -2 black hole, -1 empty planet, otherwise the race that starts there
+	std::vector<int> kind(count, -1);
+	std::vector<int> order(count);
+	for(int i=0; i<count; ++i)
+		order[i] = i;
+	for(int i=count-1; i>0; --i)
+		std::swap(order[i], order[rnd.next() % (i+1)]);
+	int next = 0;
+	for(int i=0; i<p.blackHoles && next<count; ++i)
+		kind[order[next++]] = -2;
+	int starts = std::max(races, (int)(p.planets * p.seeded));
+	for(int i=0; i<starts && next<count; ++i)
+		kind[order[next++]] = i % races;
+
+	std::string s;
+	s.reserve(count * 80);
+	s += "{\nposition: [0, 0],\nscale: 0.20,\n\nraces: [\n";
+	for(int r=0; r<races; ++r) {
+		const float *c = palette[r % paletteSize];
+		float dim = 1.0f / (1 + r / paletteSize);
+		append(s, "\t{\n\tcolor: [%.2f, %.2f, %.2f, 1.0],\n\tgrow: %.2f\n\t}%s\n", c[0]*dim, c[1]*dim, c[2]*dim,
+				rnd.randf(0.9f, 0.1f), r+1 < races ? "," : "");
+	}
+
+	std::string holes;
+	bool firstPlanet = true;
+	s += "],\n\nplanets: [\n";
+	for(int i=0; i<count; ++i) {
+		float x = (i % cols - cols * 0.5f) * spacing + rnd.randf(0, spacing * 0.25f);
+		float y = (i / cols - cols * 0.5f) * spacing + rnd.randf(0, spacing * 0.25f);
+		if(kind[i] == -2) {
+			append(holes, "%s\t{\n\tposition: [%.3f, %.3f],\n\tradius: %.2f\n\t}", holes.empty() ? "" : ",\n", x, y, rnd.randf(1.2f, 0.3f));
+			continue;
+		}
+		append(s, "%s\t{\n\tposition: [%.3f, %.3f],\n\tradius: %.2f", firstPlanet ? "" : ",\n", x, y, rnd.randf(0.3f, 0.05f));
+		firstPlanet = false;
+		if(kind[i] >= 0)
+			append(s, ",\n\ttrees: [ { race:%d, size:%.2f } ]", kind[i], p.treeSize);
+		s += "\n\t}";
+	}
+	s += "\n]";
+	if(!holes.empty())						// the parser takes no empty arrays
+		s += ",\n\nblackholes: [\n" + holes + "\n]";
+	s += "\n}\n";
+	return s;
+}
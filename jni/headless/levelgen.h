@@ -0,0 +1,36 @@
+/*  
+	Copyright (c) 2012, Alexey Saenko
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+*/ 
+
+#ifndef LEVELGEN_H
+#define LEVELGEN_H
+
+#include <string>
+
+// Stress levels for the benchmark: planets are scattered over a jittered grid,
+// every race starts on a share of them, black holes take the place of some planets.
+struct LevelGenParams {
+	unsigned int	seed;
+	int		planets, races, blackHoles;
+	float	density;		// planets per unit of area, the shipped levels keep them about 4 apart
+	float	seeded;			// share of planets that start with a tree
+	float	treeSize;		// initial tree length, a share of the planet's maximum
+
+	LevelGenParams(int p = 100): seed(1), planets(p), races(3), blackHoles(p / 50), density(1.0f / 16.0f), seeded(0.1f), treeSize(0.5f)	{}
+};
+
+// level JSON in the format of assets/levels
+std::string	generateLevel(const LevelGenParams &params);
+
+#endif
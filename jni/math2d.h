@@ -770,8 +770,6 @@ inline vec2 reflex(const vec2 &vel, const vec2 &normal) {	// vel must be normali
 	return  normal*(2.0f*(-vel*normal)) + vel;
 }
 
-float atan2(float y, float x); //Principal arc tangent of y/x, in the interval [-pi,+pi] radians.
-
 inline bool linesIntersection(const vec2 &tp1,const vec2 &tp2,const vec2 &sc1,const vec2 &sc2, vec2 &result) {
 	float z  = (tp2.y-tp1.y)*(sc1.x-sc2.x)-(sc1.y-sc2.y)*(tp2.x-tp1.x);
 	if(absf(z) < EPSILON)
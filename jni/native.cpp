@@ -23,6 +23,7 @@ static Main *game = 0;
 
 static JavaVM *javaVM = 0;
 static jobject javaObj = 0;
+static std::string dataDir;
 
 static jmethodID loadSettingsMethod = 0, saveSettingsMethod = 0, onExitMethod = 0;
 
@@ -44,12 +45,15 @@ struct JNIEnvironment {
 	bool	operator!() 	{	return env==0;	}
 };
 
-JNIEXPORT void JNICALL nativeInit(JNIEnv *env, jobject obj, jstring apkPath) {
+JNIEXPORT void JNICALL nativeInit(JNIEnv *env, jobject obj, jstring apkPath, jstring dataPath) {
 	env->GetJavaVM(&javaVM);
 	javaObj = env->NewGlobalRef(obj);
 
 	const char* str;
 	jboolean isCopy;
+	str = env->GetStringUTFChars(dataPath, &isCopy);
+	dataDir = str;
+	env->ReleaseStringUTFChars(dataPath, str);
 	str = env->GetStringUTFChars(apkPath, &isCopy);
 	game = new Main(str);
 }
@@ -109,7 +113,7 @@ JNIEXPORT void JNICALL nativeOnKey(JNIEnv *env, jobject obj, jint action, jint k
 #define JAVA_NATIVE_CLASS "com/stronggames/roots/GameSurfaceView$Engine"
 
 static JNINativeMethod methods[] = {
-	 { "init",				"(Ljava/lang/String;)V",(void*) nativeInit	},
+	 { "init",				"(Ljava/lang/String;Ljava/lang/String;)V",(void*) nativeInit	},
 	 { "draw",				"()V", 		(void*)nativeDraw 				},
 	 { "release",			"()V", 		(void*)nativeRelease 			},
 	 { "suspend",			"()V", 		(void*)nativeSuspend 			},
@@ -183,6 +187,10 @@ void saveSettings(const std::string &data) {
 	env->CallVoidMethod(javaObj, saveSettingsMethod, bytes);
 }
 
+std::string	getDataPath(const char *name) {
+	return dataDir + "/" + name;
+}
+
 };
 
 
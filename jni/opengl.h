@@ -22,6 +22,8 @@
 	#undef max
 #elif defined(ANDROID)
 	#include <GLES2/gl2.h>
+#elif defined(__linux__)
+	#include <GLES2/gl2.h>		// headless host links headless/glstub.cpp
 #endif
 
 #endif
@@ -62,10 +62,61 @@ void saveSettings(const std::string &data) {
 	os << data;
 }
 
+std::string	getDataPath(const char *name) {
+	std::string dataDir = std::string(getenv("APPDATA")) + "\\Roots";
+	createDir(dataDir);
+	return dataDir + "\\" + name;
+}
+
 };
 
 #elif defined(ANDROID)
 
 // relication in native.cpp
 
+#elif defined(__linux__)
+
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <fstream>
+
+namespace platform {
+
+static std::string settingsFilename;
+
+std::string	loadSettings() {
+	std::string result;
+	const char *home = getenv("HOME");
+	if(!home)
+		return result;
+	std::string dataDir = std::string(home) + "/.roots";
+	mkdir(dataDir.c_str(), 0755);
+	settingsFilename = dataDir + "/settings";
+	std::ifstream is(settingsFilename.c_str());
+	if(!is)
+		return result;
+	while(!is.eof()) {
+		std::string s;
+		std::getline(is, s);
+		result += s + "\n";
+	}
+	return result;
+}
+
+void saveSettings(const std::string &data) {
+	if(settingsFilename.empty())
+		return;
+	std::ofstream os(settingsFilename.c_str());
+	os << data;
+}
+
+std::string	getDataPath(const char *name) {
+	const char *home = getenv("HOME");
+	std::string dataDir = std::string(home ? home : ".") + "/.roots";
+	mkdir(dataDir.c_str(), 0755);
+	return dataDir + "/" + name;
+}
+
+};
+
 #endif
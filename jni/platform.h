@@ -29,29 +29,87 @@ inline unsigned int getTicks() {
 	return SDL_GetTicks();
 }
 
+inline unsigned long long getMicros() {
+#if SDL_VERSION_ATLEAST(2, 0, 0)
+	unsigned long long c = SDL_GetPerformanceCounter(), f = SDL_GetPerformanceFrequency();
+	return c / f * 1000000 + c % f * 1000000 / f;
+#else
+	return SDL_GetTicks() * 1000ULL;
+#endif
+}
+
 inline void sleep(unsigned int msec) {
 	SDL_Delay(msec);
 }
 
+inline int getCPUCount() {
+#if SDL_VERSION_ATLEAST(2, 0, 0)
+	return SDL_GetCPUCount();
+#else
+	return 1;
+#endif
+}
+
 #elif defined(ANDROID)
 
 #include <unistd.h>
+#include <time.h>
+
+namespace platform {
+
+inline unsigned int getTicks() {		// wall clock, clock() counts CPU time of all threads
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+inline unsigned long long getMicros() {
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+inline void sleep(unsigned int msec) {
+	usleep(msec*1000);
+}
+
+inline int getCPUCount() {
+	return sysconf(_SC_NPROCESSORS_ONLN);
+}
+
+#elif defined(__linux__)
+
+#include <unistd.h>
+#include <time.h>
 
 namespace platform {
 
 inline unsigned int getTicks() {
-	return clock() / (CLOCKS_PER_SEC/1000);
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+inline unsigned long long getMicros() {
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
 }
 
 inline void sleep(unsigned int msec) {
 	usleep(msec*1000);
 }
 
+inline int getCPUCount() {
+	return sysconf(_SC_NPROCESSORS_ONLN);
+}
+
 #endif
 
 
 void saveSettings(const std::string &data);
 std::string	loadSettings();
+std::string	getDataPath(const char *name);		// file in the writable data directory of the game
 
 
 };
@@ -17,14 +17,37 @@
 #define RAND_H
 
 #include "math2d.h"
-#include <stdlib.h>
 
-inline float randf(float center, float div) {
-	return center + div * ( (rand()/(RAND_MAX*0.5f)) - 1.0f );
-}
+// PCG32 generator, every world, planet and tree owns one so the simulation
+// repeats exactly for the same seed and does not depend on the update order of threads
+class Random {
+	unsigned long long state, inc;
+public:
+			Random(unsigned int s = 1)						{	seed(s);	}
 
-inline vec2 randVec2(const vec2 &dir = vec2(0,1), float da = PI) {
-	return mat2::get_rotate( randf(0, da) ) * dir;
-}
+	void	seed(unsigned int s, unsigned int stream = 0x5851F42D) {
+		state = 0;
+		inc = ((unsigned long long)stream << 1) | 1;
+		next();
+		state += s;
+		next();
+	}
+
+	unsigned int next() {
+		unsigned long long old = state;
+		state = old * 6364136223846793005ULL + inc;
+		unsigned int xorshifted = (unsigned int)(((old >> 18) ^ old) >> 27);
+		unsigned int rot = (unsigned int)(old >> 59);
+		return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+	}
+
+	float	randf(float center, float div) {
+		return center + div * ( next() * (2.0f / 4294967296.0f) - 1.0f );
+	}
+
+	vec2	randVec2(const vec2 &dir = vec2(0,1), float da = PI) {
+		return mat2::get_rotate( randf(0, da) ) * dir;
+	}
+};
 
 #endif
@@ -62,7 +62,7 @@ public class GameSurfaceView extends GLSurfaceView {
     			throw new RuntimeException("Unable to locate assets, aborting...");
     		}
     		apkFilePath = appInfo.sourceDir;
-    		init(apkFilePath);
+    		init(apkFilePath, context.getFilesDir().getAbsolutePath());
     	}    		
 
         public void onDrawFrame(GL10 gl) {
@@ -85,7 +85,7 @@ public class GameSurfaceView extends GLSurfaceView {
 		public void onSurfaceCreated(GL10 gl, EGLConfig config) 	{
         }
 				
-		public native void 		init(String apkPath);
+		public native void 		init(String apkPath, String dataPath);
 		public native void 		reshape(int orientation, int width, int height, float density);	        		
 		public native void 		release();	        
 		public native void 		suspend();	        